@@ -1,3 +1,6 @@
+#ifdef __linux__
+    #define _GNU_SOURCE // pthread_setaffinity_np
+#endif
 #define MINILINE_IMPLEMENTATION
 #define MINILINE_IGNORE_ZWJ
 #define MINILINE_HISTORY_SKIP_DUPLICATES
@@ -9,11 +12,37 @@
 #define NOB_NO_ECHO
 #define NOB_DA_INIT_CAP 16
 #include "nob.h"
+#include "ic.h"
 #include <assert.h>
 #include <inttypes.h>
 #include <ctype.h>
+#include <math.h>
+#include <sys/stat.h>
 #ifndef _WIN32
     #include <dlfcn.h>
+    #include <utime.h>
+    #include <signal.h>
+    #include <pthread.h>
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <sys/wait.h>
+    #include <sys/resource.h>
+    #include <sys/mman.h>
+    #include <sys/time.h>
+    #include <sys/ucontext.h>
+    #ifdef __linux__
+        #include <sched.h>
+        #include <sys/inotify.h>
+        #include <sys/ioctl.h>
+        #include <sys/syscall.h>
+        #include <linux/perf_event.h>
+    #endif
+#else
+    #include <conio.h>
+    #include <sys/utime.h>
+    #include <psapi.h>
 #endif
 
 #define STB_C_LEXER_IMPLEMENTATION
@@ -24,6 +53,8 @@
 #define CPP_SIGN "#"
 
 #define IC_EMBED
+#define IC_CACHE
+#define IC_CACHE_MAX_SIZE (256*1024*1024)
 
 typedef uint64_t usz;
 typedef Nob_String_Builder StrBuilder;
@@ -173,7 +204,7 @@ enum CompleteResult IsComplete(StrBuilder *sb, enum InputKind *inputKind)
     if (lnCom || blCom) return Incomplete;
     if (dbStr || sgStr) return Invalid; 
     if (stack.count > 0) return Incomplete;
-    if (sb->items[sb->count-2]=='\\') return Incomplete;
+    if (sb->count>=2 && sb->items[sb->count-2]=='\\') return Incomplete;
 
     enum CompleteResult r = Incomplete;
     enum InputKind outInputKind = Stmt;
@@ -269,6 +300,12 @@ enum CompleteResult IsCppComplete(StrBuilder *sb) {
     }
 }
 
+// script mode reads from here, without prompts
+FILE *scriptFile = NULL;
+// or from here for -e
+Nob_String_View scriptText = {0};
+bool useScriptText = false;
+
 int SbReadLine(StrBuilder *out, char const *prompt)
 {
 #if 0
@@ -281,6 +318,24 @@ int SbReadLine(StrBuilder *out, char const *prompt)
     } while (nob_da_last(out)!='\n');
     return 1;
 #else
+    if (useScriptText) {
+        if (scriptText.count==0) return 0;
+        Nob_String_View sv = nob_sv_chop_by_delim(&scriptText, '\n');
+        nob_sb_append_buf(out, sv.data, sv.count);
+        nob_da_append(out, '\n');
+        return 1;
+    }
+    if (scriptFile!=NULL) {
+        usz start = out->count;
+        int c;
+        while ((c = fgetc(scriptFile))!=EOF && c!='\n') {
+            nob_da_append(out, (char)c);
+        }
+        if (c==EOF && out->count==start) return 0;
+        if (out->count>start && nob_da_last(out)=='\r') out->count -= 1;
+        nob_da_append(out, '\n');
+        return 1;
+    }
     char *inp = mlReadLine(prompt);
     if (inp==NULL) return 0;
     nob_sb_append_cstr(out, inp);
@@ -302,6 +357,11 @@ bool TrimPrefix(StrBuilder *out, char const *cstr)
     return TrimPrefixSv(sv, cstr);
 }
 
+// time spent classifying input, reported with the next evaluation
+uint64_t inputNs = 0;
+// time spent in Embed by the last PrepareCString
+uint64_t embedNs = 0;
+
 enum InputKind GetInput(StrBuilder *out, usz *outLine, bool isTop, bool isTimed)
 {
     enum InputKind r = Stmt;
@@ -327,28 +387,29 @@ enum InputKind GetInput(StrBuilder *out, usz *outLine, bool isTop, bool isTimed)
             r = InputEnd;
             break;
         }
-        if (out->items[out->count-2]=='\\') {
+        uint64_t start = nob_nanos_since_unspecified_epoch();
+        bool done = true;
+        if (out->count>=2 && out->items[out->count-2]=='\\') {
             if (out->items[0]==SHL_SIGN[0]) {
                 out->count -= 2;
                 isCmd = true;
             }
-            continue;
-        }
-        line += 1;
-        if (out->items[0]==CMD_SIGN[0]) {
-            r = Cmd;
-            break;
-        }
-        if (out->items[0]==SHL_SIGN[0]) {
-            r = Shell;
-            break;
-        }
-        if (TrimPrefix(out, CPP_SIGN)) {
-            if (IsCppComplete(out)) {
-                r = Pre;
-                break;
+            done = false;
+        } else {
+            line += 1;
+            if (out->items[0]==CMD_SIGN[0]) {
+                r = Cmd;
+            } else if (out->items[0]==SHL_SIGN[0]) {
+                r = Shell;
+            } else if (TrimPrefix(out, CPP_SIGN)) {
+                if (IsCppComplete(out)) r = Pre;
+                else done = false;
+            } else {
+                done = IsComplete(out, &r);
             }
-        } else if (IsComplete(out, &r)) break;
+        }
+        inputNs += nob_nanos_since_unspecified_epoch() - start;
+        if (done) break;
     }
     nob_temp_rewind(mark);
     *outLine = line;
@@ -756,12 +817,51 @@ bool Embed(StrBuilder *res, StrBuilder *in)
 #define PATCH(FUNC) \
 "#define "#FUNC"(...) "\
     "do {"\
-        "if (__LINE__>LASTLINE) "#FUNC"(__VA_ARGS__);"\
+        "if (ONCE_LINE) "#FUNC"(__VA_ARGS__);"\
     "} while(0)\n"
 
+enum TuKind {
+    TU_REPL,    // replayed, output only for lines after LASTLINE
+    TU_PROGRAM, // standalone with a real main
+    TU_LIBRARY, // standalone shared library exporting ic_main
+};
+
+// copy without the #line markers of the cells
+void StripLineMarkers(StrBuilder *in, StrBuilder *out)
+{
+    Nob_String_View sv = nob_sv_from_parts(in->items, in->count);
+    while (sv.count>0) {
+        Nob_String_View line = nob_sv_chop_by_delim(&sv, '\n');
+        if (IsCppOf(line, "line")) continue;
+        nob_sb_append_buf(out, line.data, line.count);
+        nob_da_append(out, '\n');
+    }
+}
+
+// the host side of a unit, filled in before ic_main;
+// the unit declares the same fields as struct __IcHost
+#define IC_HOST_FIELDS \
+    void *ctx; \
+    uint64_t (*start)(void *ctx, char const *options, char const *labels, uint64_t reps, int *variant); \
+    uint64_t (*next)(void *ctx, int *variant, uint64_t reps, double ns); \
+    int (*perfOpen)(void *ctx, uint32_t events); \
+    void (*perfToggle)(void *ctx, int on, uint64_t reps); \
+    void (*perfClose)(void *ctx); \
+    void (*threads)(void *ctx, char const *options, void (*body)(uint64_t reps, int thread)); \
+    void (*units)(void *ctx, double bytes, double items); \
+    double cycleNs; \
+    void (*sweep)(void *ctx, double n); \
+    void const *(*fixture)(void *ctx, char const *name, int kind, uint64_t n, uint64_t seed, \
+        char const *path, size_t *size); \
+    int (*prof)(void *ctx, char const *options, int line); \
+    char const *conditions;
+struct IcHost { IC_HOST_FIELDS };
+#define IC_STR_(...) #__VA_ARGS__
+#define IC_STR(...) IC_STR_(__VA_ARGS__)
+
 // temp
 bool PrepareCString(usz line, StrBuilder *pre, StrBuilder *first,
-    StrBuilder *src, StrBuilder *last, StrBuilder *sb)
+    StrBuilder *src, StrBuilder *last, StrBuilder *sb, enum TuKind kind)
 {
     static char include[] = 
         "#include <stdio.h>\n"
@@ -781,9 +881,63 @@ bool PrepareCString(usz line, StrBuilder *pre, StrBuilder *first,
     
     static char line1[] = "#line 1 \"nowhere\"\n";
 
-    static char prologDefs[] = 
+    // before the code of the session, fixtures are also for its functions
+    static char prologHost[] =
+        "struct __IcHost { "IC_STR(IC_HOST_FIELDS)" };\n"
+    #ifdef _WIN32
+        "__declspec(dllexport) "
+    #endif
+        "struct __IcHost __icHost;\n"
+        "static inline uint64_t __icSplitMix(uint64_t *s) {"
+            "uint64_t z = (*s += 0x9e3779b97f4a7c15u);"
+            "z = (z^(z>>30))*0xbf58476d1ce4e5b9u;"
+            "z = (z^(z>>27))*0x94d049bb133111ebu;"
+            "return z^(z>>31);}\n"
+        // without ic (exported programs) everything is made on each call
+        "static inline void const *__icFixture(char const *name, int kind, uint64_t n,"
+            " uint64_t seed, char const *path, size_t *size) {"
+            "if (__icHost.fixture!=NULL) return __icHost.fixture(__icHost.ctx, name, kind, n, seed, path, size);"
+            "void *p = NULL; size_t sz = 0;"
+            "if (kind==4) {"
+                "FILE *f = fopen(path, \"rb\");"
+                "if (f!=NULL && fseek(f, 0, SEEK_END)==0) {"
+                    "long len = ftell(f); rewind(f);"
+                    "if (len>=0 && (p = malloc((size_t)len+1))!=NULL) sz = fread(p, 1, (size_t)len, f);}"
+                "if (f!=NULL) fclose(f);"
+                "if (p==NULL) fprintf(stderr, \"fixture %s: could not read %s\\n\", name, path);"
+            "} else {"
+                "sz = (size_t)n*(kind==1? 4: 8);"
+                "p = malloc(sz+1);"
+                "if (!p) {fprintf(stderr,\"OOM\\n\"); exit(1);}"
+                "for (uint64_t i = 0; i<n; ++i) {"
+                    "uint64_t x = __icSplitMix(&seed);"
+                    "if (kind==1) ((uint32_t *)p)[i] = (uint32_t)(x>>32);"
+                    "else if (kind==2) ((uint64_t *)p)[i] = x;"
+                    "else ((double *)p)[i] = (double)(x>>11)*(1.0/9007199254740992.0);}"
+            "}"
+            "if (size!=NULL) *size = sz;"
+            "return p;}\n"
+        "#define FIXTURE_RAND_U32(NAME, N, SEED) "
+            "uint32_t const *NAME = __icFixture(#NAME, 1, (N), (SEED), NULL, NULL)\n"
+        "#define FIXTURE_RAND_U64(NAME, N, SEED) "
+            "uint64_t const *NAME = __icFixture(#NAME, 2, (N), (SEED), NULL, NULL)\n"
+        "#define FIXTURE_RAND_F64(NAME, N, SEED) "
+            "double const *NAME = __icFixture(#NAME, 3, (N), (SEED), NULL, NULL)\n"
+        "#define FIXTURE_FILE(NAME, PATH) "
+            "size_t NAME##_size = 0;"
+            "unsigned char const *NAME = __icFixture(#NAME, 4, 0, 0, (PATH), &NAME##_size);"
+            "(void)NAME##_size\n"
+        ;
+
+    static char prologOnce[] =
         "#define ONCE_LINE (__LINE__>LASTLINE)\n"
         "#define ONCE if (__LINE__>LASTLINE)\n"
+        ;
+    static char prologOnceStandalone[] =
+        "#define ONCE_LINE 1\n"
+        "#define ONCE\n"
+        ;
+    static char prologDefs[] = 
         "#define __IC_STRINGIFY1(...) #__VA_ARGS__\n"
         "#define __IC_STRINGIFY(...) __IC_STRINGIFY1(__VA_ARGS__)\n"
         BIN_FUNCTION(8) BIN_FUNCTION(16) BIN_FUNCTION(32) BIN_FUNCTION(64)
@@ -806,6 +960,25 @@ bool PrepareCString(usz line, StrBuilder *pre, StrBuilder *first,
             "return buf;"
         "}\n"
         "#define FORMAT(FMT, ...) __alloc_sprintf(FMT, __VA_ARGS__)\n"
+        // optimizer barriers, tcc does not optimize
+        "#if defined(__GNUC__) && !defined(__TINYC__)\n"
+        "#define KEEP(X) __asm__ volatile(\"\" : : \"r,m\"(X) : \"memory\")\n"
+        // a void call stays valid, it is kept as the 0 after it
+        "#define __icSink(X) KEEP(__builtin_choose_expr("
+            "__builtin_types_compatible_p(__typeof__(X), void), ((X), 0), (X)))\n"
+        "#define CLOBBER() __asm__ volatile(\"\" : : : \"memory\")\n"
+        "#elif defined(_MSC_VER)\n"
+        // cl has no inline asm and no typeof for a volatile copy, KEEP only
+        // evaluates X; _ReadWriteBarrier orders memory but keeps no value
+        "#include <intrin.h>\n"
+        "#define KEEP(X) ((void)(X))\n"
+        "#define __icSink(X) KEEP(X)\n"
+        "#define CLOBBER() _ReadWriteBarrier()\n"
+        "#else\n"
+        "#define KEEP(X) ((void)(X))\n"
+        "#define __icSink(X) KEEP(X)\n"
+        "#define CLOBBER() ((void)0)\n"
+        "#endif\n"
         "#define WIDE(X) _Generic((X),"
             "wchar_t:__alloc_sprintf(\"%lc\",(X)),"
             "wchar_t*:__alloc_sprintf(\"%ls\",(X)),"
@@ -815,7 +988,7 @@ bool PrepareCString(usz line, StrBuilder *pre, StrBuilder *first,
     static char prologPrint[] =
         "#define PRINT(X) "
         "do {"
-            "if (__LINE__>LASTLINE) _Generic((X),"
+            "if (ONCE_LINE) _Generic((X),"
                 "int8_t:__printi8,int16_t:__printi16,"
                 "int32_t:__printi32,int64_t:__printi64,"
                 "uint8_t:__printu8,uint16_t:__printu16,"
@@ -919,23 +1092,57 @@ bool PrepareCString(usz line, StrBuilder *pre, StrBuilder *first,
         "int ic_main(int argc, char **argv) {\n"
         "(void) argc; (void) argv;\n"
         ;
+    static char prologRealMain[] =
+        "int main(int argc, char **argv) {\n"
+        "(void) argc; (void) argv;\n"
+        ;
 
     static char epilog[] = "return 0;\n}\n";
 
     char *lastline = nob_temp_sprintf("#define LASTLINE %zu\n", line);
 
 #ifdef IC_EMBED
-#define IC_APPEND_BUF(SRC) if (!Embed(sb, SRC)) return false;
+#define IC_APPEND_BUF(SRC) do { \
+        uint64_t start_ = nob_nanos_since_unspecified_epoch(); \
+        bool ok_ = Embed(sb, SRC); \
+        embedNs += nob_nanos_since_unspecified_epoch() - start_; \
+        if (!ok_) return false; \
+    } while (0)
 #else
 #define IC_APPEND_BUF(SRC) nob_sb_append_buf(sb, (SRC)->items, (SRC)->count)
 #endif
 
 #define IC_APPEND_LIT(LIT) nob_sb_append_buf(sb, (LIT), NOB_ARRAY_LEN(LIT)-1)
 
+    if (kind!=TU_REPL) {
+        // no replay: no LASTLINE, no patched output, no cell line markers
+        static StrBuilder strippedPre = {0}, strippedSrc = {0};
+        strippedPre.count = 0;
+        strippedSrc.count = 0;
+        StripLineMarkers(pre, &strippedPre);
+        StripLineMarkers(src, &strippedSrc);
+        IC_APPEND_LIT(include);
+        IC_APPEND_LIT(prologHost);
+        IC_APPEND_LIT(prologOnceStandalone);
+        IC_APPEND_LIT(prologDefs);
+        IC_APPEND_LIT(prologPrint);
+        IC_APPEND_BUF(&strippedPre);
+        if (kind==TU_PROGRAM) {
+            IC_APPEND_LIT(prologRealMain);
+        } else {
+            IC_APPEND_LIT(prologMain);
+        }
+        IC_APPEND_BUF(&strippedSrc);
+        IC_APPEND_LIT(epilog);
+        return true;
+    }
+
     IC_APPEND_LIT(include);
+    IC_APPEND_LIT(prologHost);
     IC_APPEND_BUF(pre);
     IC_APPEND_BUF(first);
     IC_APPEND_LIT(line1);
+    IC_APPEND_LIT(prologOnce);
     IC_APPEND_LIT(prologDefs);
     IC_APPEND_LIT(prologPrint);
     IC_APPEND_LIT(prologPatch);
@@ -948,12 +1155,332 @@ bool PrepareCString(usz line, StrBuilder *pre, StrBuilder *first,
     return true;
 }
 
-char const *myCompiler = NULL;
+typedef enum RunType {
+    RT_MEM,
+    RT_DLL,
+    RT_CC,
+} RunType;
+
+struct ProfLine {
+    usz line;
+    uint64_t ns;
+    uint64_t calls;
+};
+
+// phases of one evaluation, see ;stats and IC_TRACE
+enum Phase {
+    PH_INPUT,    // IsComplete/IsCppComplete on the cell
+    PH_PREPARE,  // PrepareCString without Embed
+    PH_EMBED,
+    PH_COMPILE,  // tcc or cc, including the cache
+    PH_LOAD,     // tcc_relocate or dlopen
+    PH_RUN,      // ic_main
+    PH_TEARDOWN, // unloading the previous unit and cleanup
+    PH_COUNT,
+};
+
+char const *phaseNames[PH_COUNT] = {
+    "input", "prepare", "embed", "compile", "load", "run", "teardown",
+};
+
+// getrusage deltas, on windows only the cpu times and page faults
+struct Usage {
+    uint64_t utimeNs, stimeNs;
+    long maxrssKb;
+    long minflt, majflt;
+    long nvcsw, nivcsw;
+};
+
+struct EvalStats {
+    usz eval;
+    uint64_t at[PH_COUNT]; // start of each phase, nob_nanos_since_unspecified_epoch()
+    uint64_t ns[PH_COUNT];
+    uint64_t total;
+    usz srcBytes;
+    usz rssKb;
+    struct Usage usage; // of ic_main
+    RunType rt;
+    bool cached;
+    bool ok;
+};
+
+#define IC_STATS_MAX 256
+
+// ;t[:reps] [--option...]
+struct TimeOptions {
+    bool once;
+    bool rusage; // getrusage deltas of the timed region
+    bool bench;  // warmup, calibration and samples, driven by BenchNext()
+    double warmupNs;
+    double minTimeNs; // of a sample
+    double maxTimeNs; // sampling stops early after it
+    usz samples;
+    uint32_t perfEvents; // bits of perfEventNames
+    int threads[16]; // ;t@1,2,4: thread counts to run the statement on
+    usz threadsCount;
+    // expressions of the session per iteration, for throughput
+    char bytes[128];
+    char items[128];
+    // results store under dataDir/bench, "" for none
+    char save[64];
+    char compare[64];
+};
+
+enum BenchPhase {
+    BENCH_WARMUP,
+    BENCH_CALIBRATE,
+    BENCH_SAMPLE,
+};
+
+// hardware counters of ;t --perf
+char const *perfEventNames[] = {
+    "cycles", "instructions", "branches", "branch-misses", "cache-references", "cache-misses",
+    "L1-dcache-loads", "L1-dcache-load-misses", "LLC-loads", "LLC-load-misses", "dTLB-load-misses",
+};
+#define IC_PERF_MAX NOB_ARRAY_LEN(perfEventNames)
+#define IC_PERF_DEFAULT "cycles,instructions,L1-dcache-load-misses,LLC-load-misses,branch-misses"
+
+struct Perf {
+    int fds[IC_PERF_MAX]; // -1: not open, fds[0] leads the group
+    int events[IC_PERF_MAX];
+    usz count;
+    bool on;
+    uint64_t reps; // iterations while counting
+    // of the last PerfClose(), for --save
+    double perRep[IC_PERF_MAX];
+    uint32_t counted; // bits of perfEventNames
+};
+
+// a statement of ;bench, ;t has one
+struct BenchVariant {
+    char label[32];
+    uint64_t reps;
+    struct {
+        double *items; // ns per iteration
+        usz count;
+        usz capacity;
+    } samples;
+};
+
+#define IC_BENCH_MAX 8
+#define IC_THREADS_MAX 256
+
+struct Bench {
+    bool active; // between BenchStart() and the last BenchNext()
+    struct TimeOptions opts;
+    enum BenchPhase phase;
+    bool fixedReps;
+    uint64_t begin; // of the phase
+    double warmupNs;
+    struct BenchVariant variants[IC_BENCH_MAX];
+    usz count;
+    usz current; // variant of the running batch
+    // sampling goes in rounds over all variants in a random order
+    usz order[IC_BENCH_MAX];
+    usz orderPos;
+    uint64_t seed;
+    double bytes, items; // per iteration, 0: not given
+    bool hold; // ;tm: the samples are reported by the matrix
+    bool storePending; // --save/--compare wait for the counters of PerfClose()
+    char const *conditions; // of ;quiet, NULL when off
+};
+
+#define IC_SWEEP_MAX 64
+
+// a value of ;sweep
+struct SweepPoint {
+    double n;
+    uint64_t reps;
+    double min, median, mean, ci;
+    double bytes, items; // per iteration
+};
+
+struct Sweep {
+    bool active; // between the first and the last point
+    double n;    // of the running point
+    char name[32];
+    char csv[256]; // "" for none
+    struct {
+        struct SweepPoint *items;
+        usz count;
+        usz capacity;
+    } points;
+};
+
+// ;prof, a SIGPROF sampler around one statement
+struct Sampler {
+    bool active; // while the timer runs
+    int hz;
+    double minNs; // the statement runs again until then
+    char folded[256]; // "" for none
+    usz line;     // of the statement, where ic_main's samples go
+    uint64_t startNs;
+    double cpuStartNs;
+    uint64_t runs;
+};
+
+// ;quiet, applied around each ic_main
+struct Quiet {
+    bool on;
+    int cpu;
+    bool priority;
+    char conditions[160]; // as last applied, "" when off
+#ifdef _WIN32
+    DWORD_PTR oldMask;
+    int oldPriority;
+#else
+#ifdef __linux__
+    cpu_set_t oldMask;
+#endif
+    int oldPriority;
+    bool locked;
+#endif
+    bool pinned;
+};
+
+// FIXTURE_*, generated or loaded once and kept across evaluations;
+// prologHost passes the numbers
+enum FixtureKind {
+    FIXTURE_U32 = 1,
+    FIXTURE_U64,
+    FIXTURE_F64,
+    FIXTURE_FILE,
+};
+
+struct Fixture {
+    char *name;
+    enum FixtureKind kind;
+    uint64_t n, seed;
+    char *path; // FIXTURE_FILE, reloaded when the file changes
+    time_t mtime;
+    uint64_t fileSize;
+    usz checked; // runCount+1 of the evaluation that last looked at the file
+    void *data;
+    size_t size;
+    bool mapped;
+};
+
+#ifdef _WIN32
+struct MyHMODULEs {
+    HMODULE *items;
+    usz count;
+    usz capacity;
+};
+#endif
+
+enum CompilerType {
+    COMPILER_UNDECIDED,
+    CL_EXE,
+    OTHER_COMPILER,
+};
+
+struct BatchCell {
+    usz preCount, srcCount;
+    usz line;
+};
+
+typedef struct Session {
+    usz line;
+    StrBuilder out, pre, first, src, last, temp, tempCc;
+    Nob_Cmd opt, arg;
+    RunType rt;
+    bool werror;
+    // script mode: cells are collected into src and run by Flush()
+    bool batch;
+    bool pending;
+    usz runLine;
+    bool failed;
+    // where each pending cell starts, to run them one by one if the batch fails
+    struct {
+        struct BatchCell *items;
+        usz count;
+        usz capacity;
+    } cells;
+    // compiler messages of a batch, only shown if it compiles
+    bool holdErrors;
+    StrBuilder heldErrors;
+    int status; // returned by the last ic_main
+
+    // backend, kept per session so that several can live in one process
+    char const *tccDir;
+    char const *incDir;
+    char const *libDir;
+    char const *nobDir;
+    char const *workDir;
+    char const *cacheDir; // NULL: no compile cache
+    bool useDataDir;      // repl: workDir comes from SetupDataPaths()
+    bool ownsWorkDir;
+    char const *inpPath;
+    char const *outRedirect;
+    char const *errRedirect;
+    StrBuilder rawOutPath, outPath;
+    usz evalCount;
+    char const *compiler; // NULL: $CC or the default of nob
+    enum CompilerType compilerType;
+    StrBuilder compilerIdent; // compiler path and its version banner, for cache keys
+    StrBuilder sbSrc, sbOpt;
+    bool busy;
+    bool ranMain; // the last Run got as far as calling ic_main
+    usz runCount, errorCount;
+    // replaces Run, e.g. to run in a child process
+    int (*runHook)(struct Session *ss, usz line, StrBuilder *first, StrBuilder *last);
+    // server mode
+    usz requestCount;
+    uint64_t serveNanos;
+    uint64_t builtKey; // cache key of the unit the last Run built or found, 0 if none
+    bool buildOnly; // ;save: Run compiles the unit into the cache, nothing is loaded
+    // ;replay-profile, accumulated over replays
+    struct {
+        struct ProfLine *items;
+        usz count;
+        usz capacity;
+    } prof;
+    usz profRuns;
+    // ;stats, a ring of the last evaluations
+    struct EvalStats stats[IC_STATS_MAX];
+    usz statsCount;
+    struct Bench bench; // the running ;t --bench
+    char const *prebuilt; // ;tm: a unit compiled beforehand, Run loads it instead
+    struct Quiet quiet;
+    struct Sweep sweep; // the running ;sweep
+    struct Sampler sampler; // the running ;prof
+    bool framePointers; // a ;prof cell is in the unit, cc keeps frame pointers
+    struct {
+        struct Fixture *items;
+        usz count;
+        usz capacity;
+    } fixtures;
+    struct Perf perf;
+
+    // the last compiled unit stays loaded until the next one replaces it
+    TCCState *state;
+#ifdef _WIN32
+    HMODULE handle;
+    struct MyHMODULEs loadedDlls;
+#else
+    void *handle;
+#endif
+    StrBuilder liveRawOutPath;
+} Session;
+
+char *HeapSprintf(char const *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    char *buf = malloc(n+1);
+    assert(buf!=NULL);
+    va_start(args, fmt);
+    vsnprintf(buf, n+1, fmt, args);
+    va_end(args);
+    return buf;
+}
 
-char const *GetCompiler(void)
+char const *GetCompiler(Session *ss)
 {
-    if (myCompiler!=NULL) {
-        return myCompiler;
+    if (ss->compiler!=NULL) {
+        return ss->compiler;
     }
     char *compiler = GetCC();
     if (compiler!=NULL) {
@@ -968,6 +1495,7 @@ char const *GetCompiler(void)
     return test.items[0];
 }
 
+// defaults of the repl session
 char const *exePath;
 
 char const *tccPath;
@@ -976,19 +1504,97 @@ char const *libPath;
 
 char const *dataDir;
 char const *tempDir;
+char const *workDir;
 
-char const *outRedirect;
-char const *errRedirect;
-
-char const *rawOutPath;
-char const *outPath;
+char const *dllExt =
+#ifdef _WIN32
+    ".dll"
+#else
+    ".so"
+#endif
+    ;
 
-char const *inpPath;
+char const *cacheDir;
 
 char const *hisPath;
 
+int GetPid(void)
+{
+#ifdef _WIN32
+    return (int)GetCurrentProcessId();
+#else
+    return (int)getpid();
+#endif
+}
+
+bool IsProcessAlive(int pid)
+{
+#ifdef _WIN32
+    HANDLE h = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+    if (h==NULL) return GetLastError()==ERROR_ACCESS_DENIED;
+    bool alive = WaitForSingleObject(h, 0)==WAIT_TIMEOUT;
+    CloseHandle(h);
+    return alive;
+#else
+    return kill(pid, 0)==0 || errno==EPERM;
+#endif
+}
+
+bool RemoveTreeVisit(Nob_Walk_Entry entry)
+{
+    nob_delete_file(entry.path);
+    return true;
+}
+
+void RemoveTree(char const *path)
+{
+    Nob_Log_Level old = nob_minimal_log_level;
+    nob_minimal_log_level = NOB_NO_LOGS;
+    nob_walk_dir(path, RemoveTreeVisit, .post_order = true);
+    nob_minimal_log_level = old;
+}
+
+// remove workspaces left behind by instances that crashed
+void ReapWorkspaces(void)
+{
+    Nob_File_Paths names = {0};
+    size_t mark = nob_temp_save();
+    if (!nob_read_entire_dir(tempDir, &names)) goto end;
+    for (usz i = 0; i<names.count; ++i) {
+        char const *name = names.items[i];
+        char *endp;
+        long pid = strtol(name, &endp, 10);
+        if (endp==name || *endp!='\0' || pid<=0) continue;
+        if (pid==GetPid() || IsProcessAlive((int)pid)) continue;
+        RemoveTree(nob_temp_sprintf("%s/%s", tempDir, name));
+    }
+end:
+    nob_da_free(names);
+    nob_temp_rewind(mark);
+}
+
+void CleanupWorkspace(void)
+{
+    if (workDir!=NULL) RemoveTree(workDir);
+}
+
+// cheap, needed by every run type
 void SetupPaths(void)
 {
+    exePath = GetExePath();
+
+    // tcc paths
+    tccPath = GetExePath();
+    incPath = nob_temp_sprintf("%s/include", tccPath);
+    libPath = nob_temp_sprintf("%s/lib", tccPath);
+}
+
+// touches the file system, only needed by the repl, dll and cc
+// not inside a temp mark, the paths live on the temporary storage
+void SetupDataPaths(void)
+{
+    if (dataDir!=NULL) return;
+
     bool isDataDirHidden = false;
 #ifdef _WIN32
     char const *dataDirEnv = GetEnvTemp("LOCALAPPDATA");
@@ -1004,13 +1610,6 @@ void SetupPaths(void)
     }
 #endif
 
-    exePath = GetExePath();
-
-    // tcc paths
-    tccPath = GetExePath();
-    incPath = nob_temp_sprintf("%s/include", tccPath);
-    libPath = nob_temp_sprintf("%s/lib", tccPath);
-
     // data and temp directories
     dataDir = nob_temp_sprintf("%s/%s", dataDirEnv, isDataDirHidden? ".ic": "ic");
     tempDir = nob_temp_sprintf("%s/temp", dataDir);
@@ -1018,94 +1617,183 @@ void SetupPaths(void)
     assert(nob_mkdir_if_not_exists(dataDir));
     assert(nob_mkdir_if_not_exists(tempDir));
 
+    // private workspace of this instance, removed on exit
+    ReapWorkspaces();
+    workDir = nob_temp_sprintf("%s/%d", tempDir, GetPid());
+    RemoveTree(workDir);
+    assert(nob_mkdir_if_not_exists(workDir));
+
+    // compiled shared objects shared by all sessions
+    cacheDir = nob_temp_sprintf("%s/cache", dataDir);
+    assert(nob_mkdir_if_not_exists(cacheDir));
+
+    // repl history file
+    hisPath = nob_temp_sprintf("%s/ic_history.txt", dataDir);
+}
+
+void SessionSetTccDir(Session *ss, char const *tccDir)
+{
+    ss->tccDir = HeapSprintf("%s", tccDir);
+    ss->incDir = HeapSprintf("%s/include", tccDir);
+    ss->libDir = HeapSprintf("%s/lib", tccDir);
+    // nob.h sits next to the tcc files
+    ss->nobDir = ss->tccDir;
+}
+
+void SessionSetWorkDir(Session *ss, char const *dir)
+{
+    ss->workDir = HeapSprintf("%s", dir);
     // for compiler detection & cl.exe output redirection
-    outRedirect = nob_temp_sprintf("%s/_cc_out.txt", tempDir);
-    errRedirect = nob_temp_sprintf("%s/_cc_err.txt", tempDir);
+    ss->outRedirect = HeapSprintf("%s/_cc_out.txt", dir);
+    ss->errRedirect = HeapSprintf("%s/_cc_err.txt", dir);
+    // input file for cc
+    ss->inpPath = HeapSprintf("%s/_ic.c", dir);
+}
 
-    // output path without extension for cl.exe
-    rawOutPath = nob_temp_sprintf("%s/ic", tempDir);
+// private temp directory for sessions that did not get one
+bool SessionEnsureWorkDir(Session *ss)
+{
+    static usz sessionCount = 0;
+    if (ss->workDir!=NULL) return true;
+    if (ss->useDataDir) {
+        SetupDataPaths();
+        SessionSetWorkDir(ss, workDir);
+        ss->cacheDir = HeapSprintf("%s", cacheDir);
+        return true;
+    }
 
-    // output ic shared library
-    char const *ext = 
+    size_t mark = nob_temp_save();
 #ifdef _WIN32
-    ".dll"
+    char const *tmp = GetEnvTemp("TEMP");
+    if (tmp==NULL) tmp = ".";
 #else
-    ".so"
+    char const *tmp = GetEnvTemp("TMPDIR");
+    if (tmp==NULL) tmp = "/tmp";
 #endif
-    ;
-    outPath = nob_temp_sprintf("%s%s", rawOutPath, ext);
+    char const *dir = nob_temp_sprintf("%s/ic-%d-%zu", tmp, GetPid(), ++sessionCount);
+    bool ok = nob_mkdir_if_not_exists(dir);
+    if (ok) {
+        SessionSetWorkDir(ss, dir);
+        ss->ownsWorkDir = true;
+    }
+    nob_temp_rewind(mark);
+    return ok;
+}
 
-    // input file for cc
-    inpPath = nob_temp_sprintf("%s/_ic.c", tempDir);
+// unique per evaluation, dlopen may return a stale mapping for a reused path
+void NextOutPath(Session *ss)
+{
+    ss->evalCount += 1;
 
-    // repl history file
-    hisPath = nob_temp_sprintf("%s/ic_history.txt", dataDir);
+    // output path without extension for cl.exe
+    ss->rawOutPath.count = 0;
+    nob_sb_appendf(&ss->rawOutPath, "%s/ic%zu", ss->workDir, ss->evalCount);
+    nob_sb_append_null(&ss->rawOutPath);
+
+    // output ic shared library
+    ss->outPath.count = 0;
+    nob_sb_appendf(&ss->outPath, "%s%s", ss->rawOutPath.items, dllExt);
+    nob_sb_append_null(&ss->outPath);
 }
 
-enum CompilerType {
-    COMPILER_UNDECIDED,
-    CL_EXE,
-    OTHER_COMPILER,
-} compilerType = COMPILER_UNDECIDED;
+void RemoveOutPath(char const *rawOutPath)
+{
+    static char const *const exts[] = { "", ".lib", ".exp", ".obj" };
+    size_t mark = nob_temp_save();
+    Nob_Log_Level old = nob_minimal_log_level;
+    nob_minimal_log_level = NOB_NO_LOGS;
+    for (usz i = 0; i<NOB_ARRAY_LEN(exts); ++i) {
+        char const *p = nob_temp_sprintf("%s%s", rawOutPath, i==0? dllExt: exts[i]);
+        if (nob_file_exists(p)==1) nob_delete_file(p);
+    }
+    nob_minimal_log_level = old;
+    nob_temp_rewind(mark);
+}
 
-void SetCompilerType(void)
+void SetCompilerType(Session *ss)
 {
     Nob_Cmd cc = {0};
-    nob_da_append(&cc, GetCompiler());
+    nob_da_append(&cc, GetCompiler(ss));
     nob_da_append(&cc, "--version");
     Nob_Log_Level old = nob_minimal_log_level;
     nob_minimal_log_level = NOB_NO_LOGS;
-    nob_cmd_run(&cc, .stdout_path=outRedirect, .stderr_path=errRedirect);
+    nob_cmd_run(&cc, .stdout_path=ss->outRedirect, .stderr_path=ss->errRedirect);
     nob_minimal_log_level = old;
     nob_da_free(cc);
 
+    ss->compilerIdent.count = 0;
+    nob_sb_append_cstr(&ss->compilerIdent, GetCompiler(ss));
+    nob_da_append(&ss->compilerIdent, '\n');
+    nob_read_entire_file(ss->outRedirect, &ss->compilerIdent);
+
     StrBuilder sb = {0};
-    if (!nob_read_entire_file(errRedirect, &sb)) { return; }
+    if (!nob_read_entire_file(ss->errRedirect, &sb)) { return; }
+    nob_sb_append_buf(&ss->compilerIdent, sb.items, sb.count);
     if (nob_sv_starts_with(nob_sv_from_parts(sb.items, sb.count), 
             nob_sv_from_cstr("Microsoft (R) C/C++ Optimizing Compiler"))) {
-        compilerType = CL_EXE;
+        ss->compilerType = CL_EXE;
     } else {
-        compilerType = OTHER_COMPILER;
+        ss->compilerType = OTHER_COMPILER;
     }
     nob_sb_free(sb);
 }
 
-void CompilerSetup(Nob_Cmd *cc)
+void CompilerSetup(Session *ss, Nob_Cmd *cc)
 {
-    if (compilerType==CL_EXE) {
+    if (ss->compilerType==CL_EXE) {
         nob_da_append(cc, "/nologo");
         nob_da_append(cc, "/std:c17");
     }
 }
 
-void TranslateWerror(Nob_Cmd *cc)
+void TranslateWerror(Session *ss, Nob_Cmd *cc)
 {
-    if (compilerType==CL_EXE) {
+    if (ss->compilerType==CL_EXE) {
         nob_da_append(cc, "/WX");
     } else  {
         nob_da_append(cc, "-Werror");
     }
 }
 
-void TranslateDllOutput(Nob_Cmd *cc)
+void TranslateDllOutput(Session *ss, Nob_Cmd *cc)
 {
-    if (compilerType==CL_EXE) {
+    if (ss->compilerType==CL_EXE) {
         nob_cmd_append(cc, "/LD",
-            nob_temp_sprintf("/Fo:%s", rawOutPath),
-            nob_temp_sprintf("/Fe:%s", rawOutPath));
+            nob_temp_sprintf("/Fo:%s", ss->rawOutPath.items),
+            nob_temp_sprintf("/Fe:%s", ss->rawOutPath.items));
     } else  {
-        nob_cmd_append(cc, "-shared", "-o", outPath);
+        nob_cmd_append(cc, "-shared", "-o", ss->outPath.items);
     }
 }
 
-bool TranslateCompile(Nob_Cmd *cc)
+void HoldTccError(void *opaque, char const *msg)
+{
+    Session *ss = opaque;
+    nob_sb_append_cstr(&ss->heldErrors, msg);
+    nob_da_append(&ss->heldErrors, '\n');
+}
+
+bool TranslateCompile(Session *ss, Nob_Cmd *cc)
 {
     Nob_Cmd_Opt ccOpt = {0};
-    if (compilerType==CL_EXE) {
-        ccOpt.stdout_path = outRedirect;
+    if (ss->compilerType==CL_EXE) {
+        ccOpt.stdout_path = ss->outRedirect;
+    }
+    Nob_Log_Level old = nob_minimal_log_level;
+    if (ss->holdErrors) {
+        ccOpt.stderr_path = ss->errRedirect;
+        nob_minimal_log_level = NOB_NO_LOGS;
     }
-    if (!nob_cmd_run_opt(cc, ccOpt)) {
-        if (compilerType==CL_EXE) {
+    bool ok = nob_cmd_run_opt(cc, ccOpt);
+    nob_minimal_log_level = old;
+    if (ss->holdErrors) {
+        ss->heldErrors.count = 0;
+        nob_read_entire_file(ss->errRedirect, &ss->heldErrors);
+        if (ss->compilerType==CL_EXE) nob_read_entire_file(ss->outRedirect, &ss->heldErrors);
+        return ok;
+    }
+    if (!ok) {
+        if (ss->compilerType==CL_EXE) {
             StrBuilder ccErr = {0};
             if (nob_read_entire_file(ccOpt.stdout_path, &ccErr)) {
                 if (nob_da_last(&ccErr)=='\n') ccErr.count -= 1;
@@ -1263,12 +1951,6 @@ bool WinSearchDlls(Nob_Cmd *opt, struct MyListOfStrings *full_dlls)
     return true;
 }
 
-struct MyHMODULEs {
-    HMODULE *items;
-    usz count;
-    usz capacity;
-};
-
 bool WinLoadDlls(struct MyListOfStrings *full_dlls, struct MyHMODULEs *hs)
 {
     for (usz i = 0; i<full_dlls->count; ++i) {
@@ -1313,666 +1995,5652 @@ bool WinImportDlls(TCCState *s, struct MyListOfStrings *full_dlls, struct MyHMOD
 
 #endif
 
-typedef enum RunType {
-    RT_MEM,
-    RT_DLL,
-    RT_CC,
-} RunType;
+// argv[0] of ic_main, the script path for #! scripts
+char const *programName = NULL;
 
-int Run(RunType rt, usz line,
-    Nob_Cmd *opt, Nob_Cmd *arg, 
-    StrBuilder *pre, StrBuilder *first,
-    StrBuilder *src, StrBuilder *last,
-    bool werror)
-{
-    typedef int (*IcMain)(int, char **);
-    IcMain ic_main;
-    TCCState *s = NULL;
-    static StrBuilder sbSrc = {0}, sbOpt = {0};
-    int r = -1;
-    usz i, mark = nob_temp_save();
-    int myArgsLen = 1+(int)arg->count; assert(arg->count<INT32_MAX);
-    char **myArgs = nob_temp_alloc((myArgsLen)*sizeof(char *));
-#ifdef _WIN32
-    HMODULE h = NULL;
-    struct MyHMODULEs loadedDlls = {0};
-    struct MyListOfStrings full_dlls = {0};
-#else
-    void *h = NULL;
-#endif
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
 
-    // args to main
-    myArgs[0] = nob_temp_running_executable_path();
-    for (i = 0; i<arg->count; ++i) {
-        myArgs[1+i] = nob_temp_strdup(arg->items[i]);
+uint64_t HashBuf(uint64_t h, void const *buf, usz n)
+{
+    unsigned char const *p = buf;
+    for (usz i = 0; i<n; ++i) {
+        h ^= p[i];
+        h *= FNV_PRIME;
     }
+    return h;
+}
 
-    // prepare in memory c src code
-    sbSrc.count = 0;
-    if (!PrepareCString(line, pre, first, src, last, &sbSrc)) goto end;
-    if (rt!=RT_CC) nob_sb_append_null(&sbSrc);
-
-    if (rt==RT_CC) {
-        Nob_Cmd cc = {0};
-        // write to inpPath
-        if (!nob_write_entire_file(inpPath, sbSrc.items, sbSrc.count)) goto end;
+uint64_t HashCstr(uint64_t h, char const *cstr)
+{
+    // include the terminator so that ("ab","c") != ("a","bc")
+    return HashBuf(h, cstr, strlen(cstr)+1);
+}
 
-        if (compilerType==COMPILER_UNDECIDED) {
-            SetCompilerType();
+// follow #include "..." and <...> found under -I so that editing a header
+// invalidates the key; system headers are only hashed by name, the compiler
+// identity covers their upgrades
+uint64_t HashIncludes(uint64_t h, char const *buf, usz len, char const *dir, Nob_Cmd *opt, int depth)
+{
+    if (depth>16) return h;
+    for (usz i = 0; i<len; ++i) {
+        usz j;
+        for (j = 0; i+j<len && buf[i+j]!='\n'; ++j) {}
+        Nob_String_View sv = nob_sv_from_parts(buf+i, j);
+        i += j;
+        if (!IsCppOf(sv, "include")) continue;
+
+        char const *q = memchr(sv.data, '\"', sv.count);
+        bool angle = q==NULL;
+        if (angle) q = memchr(sv.data, '<', sv.count);
+        if (q==NULL) continue;
+        char const *e = memchr(q+1, angle? '>': '\"', sv.count-(q+1-sv.data));
+        if (e==NULL) continue;
+
+        size_t mark = nob_temp_save();
+        char const *name = nob_temp_strndup(q+1, e-(q+1));
+        char const *path = NULL;
+        char const *cand;
+        if (!angle) {
+            cand = nob_temp_sprintf("%s/%s", dir, name);
+            if (nob_file_exists(cand)==1) path = cand;
         }
-
-        nob_da_append(&cc, GetCompiler());
-        CompilerSetup(&cc);
-        if (werror) {
-            TranslateWerror(&cc);
+        for (usz k = 0; path==NULL && k<opt->count; ++k) {
+            char const *o = opt->items[k];
+            if (strncmp(o, "-I", 2)!=0) continue;
+            if (o[2]=='\0') {
+                if (k+1>=opt->count) break;
+                o = opt->items[++k];
+            } else {
+                o += 2;
+            }
+            cand = nob_temp_sprintf("%s/%s", o, name);
+            if (nob_file_exists(cand)==1) path = cand;
         }
-        for (usz i = 0; i<opt->count; ++i) {
-            nob_da_append(&cc, opt->items[i]);
+
+        StrBuilder content = {0};
+        if (path!=NULL && nob_read_entire_file(path, &content)) {
+            h = HashCstr(h, name);
+            h = HashBuf(h, content.items, content.count);
+            h = HashIncludes(h, content.items, content.count,
+                nob_temp_dir_name(path), opt, depth+1);
+        } else {
+            // not found (or a system header); the compiler will complain if needed
+            h = HashCstr(h, name);
         }
-        nob_cc_inputs(&cc, inpPath);
-        TranslateDllOutput(&cc);
-        nob_da_append(&cc, nob_temp_sprintf("-I%s", exePath)); // for nob.h
+        nob_sb_free(content);
+        nob_temp_rewind(mark);
+    }
+    return h;
+}
 
-        bool rslt = TranslateCompile(&cc);
-        nob_da_free(cc);
-        if (!rslt) goto end;
+uint64_t CacheKey(Session *ss, StrBuilder *sbSrc)
+{
+    RunType rt = ss->rt;
+    bool werror = ss->werror;
+    Nob_Cmd *opt = &ss->opt;
+    uint64_t h = FNV_OFFSET;
+    h = HashBuf(h, &rt, sizeof(rt));
+    h = HashBuf(h, &werror, sizeof(werror));
+    if (rt==RT_CC) {
+        h = HashBuf(h, ss->compilerIdent.items, ss->compilerIdent.count);
+        h = HashBuf(h, &ss->framePointers, sizeof(ss->framePointers));
     } else {
-        // prepare quoted options
-        sbOpt.count = 0;
-        if (werror) {
-            nob_sb_append_cstr(&sbOpt, "-Werror ");
-        }
-        SimpleQuote(opt->items, opt->count, &sbOpt);
-        nob_sb_append_null(&sbOpt);
-        
-        // compile by tcc
-        s = tcc_new();
-        tcc_set_output_type(s, rt==RT_DLL? TCC_OUTPUT_DLL: TCC_OUTPUT_MEMORY);
-        tcc_set_options(s, sbOpt.items);
-        tcc_set_lib_path(s, tccPath);
-        tcc_add_sysinclude_path(s, incPath);
-        tcc_add_library_path(s, libPath);
-    #ifndef _WIN32
-        tcc_add_library_path(s, tccPath);
-    #endif
-        tcc_add_include_path(s, exePath); // for nob.h
+        h = HashCstr(h, "tcc");
+        h = HashCstr(h, ss->tccDir);
+    }
+    for (usz i = 0; i<opt->count; ++i) {
+        h = HashCstr(h, opt->items[i]);
+    }
+    h = HashBuf(h, sbSrc->items, sbSrc->count);
+    // cc sees the source in inpPath, tcc compiles a string from cwd
+    h = HashIncludes(h, sbSrc->items, sbSrc->count,
+        rt==RT_CC? nob_temp_dir_name(ss->inpPath): nob_get_current_dir_temp(), opt, 0);
+    // final avalanche, fnv alone leaves similar keys for similar inputs
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
 
-    #ifdef _WIN32
-        if (rt==RT_MEM) {
-            if (!WinSearchDlls(opt, &full_dlls)) goto end;
-            if (!WinLoadDlls(&full_dlls, &loadedDlls)) goto end;
-            if (!WinImportDlls(s, &full_dlls, &loadedDlls)) goto end;
-        }
-    #endif
+// temp
+char *CachePath(char const *dir, uint64_t key)
+{
+    return nob_temp_sprintf("%s/%016"PRIx64"%s", dir, key, dllExt);
+}
 
-        r = tcc_compile_string(s, sbSrc.items);
-        if (r==-1) goto end;
-    }
+// touch the entry so that eviction sees it as recently used
+// temp
+char *CacheLookup(char const *dir, uint64_t key)
+{
+    char *path = CachePath(dir, key);
+    if (nob_file_exists(path)!=1) return NULL;
+#ifdef _WIN32
+    _utime(path, NULL);
+#else
+    utime(path, NULL);
+#endif
+    return path;
+}
 
-    if (rt==RT_DLL) {
-        r = tcc_output_file(s, outPath);
-        if (r==-1) goto end;
-    } else if (rt==RT_MEM) {
-        r = tcc_relocate(s);
-        if (r==-1) goto end;
-    }
+struct CacheEntry {
+    char const *path;
+    time_t mtime;
+    uint64_t size;
+};
 
-    if (rt==RT_MEM) {
-        ic_main = tcc_get_symbol(s, "ic_main");
-    } else {
-    #ifdef _WIN32
-        h = LoadLibraryA(outPath);
-        ic_main = (void *)GetProcAddress(h, "ic_main");
-    #else
-        h = dlopen(outPath, RTLD_NOW);
-        ic_main = (void *)dlsym(h, "ic_main");
-    #endif
-    }
+int CacheEntryCmp(void const *a, void const *b)
+{
+    struct CacheEntry const *x = a, *y = b;
+    return (x->mtime > y->mtime) - (x->mtime < y->mtime);
+}
 
-    if (ic_main!=NULL) {
-        r = ic_main(myArgsLen, myArgs);
-    } else {
-        nob_log(NOB_ERROR, "%s", "failed to get compiled function");
-        r = -1;
+// drop least recently used entries until the cache fits
+void CacheEvict(char const *dir)
+{
+    struct {
+        struct CacheEntry *items;
+        usz count;
+        usz capacity;
+    } entries = {0};
+    Nob_File_Paths names = {0};
+    uint64_t total = 0;
+    time_t now = time(NULL);
+    size_t mark = nob_temp_save();
+
+    if (!nob_read_entire_dir(dir, &names)) goto end;
+    for (usz i = 0; i<names.count; ++i) {
+        char const *name = names.items[i];
+        if (name[0]=='.') continue;
+        char const *path = nob_temp_sprintf("%s/%s", dir, name);
+        struct stat st;
+        if (stat(path, &st)!=0) continue;
+        // leftovers of an interrupted store
+        if (nob_sv_end_with(nob_sv_from_cstr(name), ".tmp")) {
+            if (now - st.st_mtime > 60*60) nob_delete_file(path);
+            continue;
+        }
+        struct CacheEntry e = { path, st.st_mtime, (uint64_t)st.st_size };
+        nob_da_append(&entries, e);
+        total += e.size;
+    }
+    if (total<=IC_CACHE_MAX_SIZE) goto end;
+
+    qsort(entries.items, entries.count, sizeof(*entries.items), CacheEntryCmp);
+    for (usz i = 0; i<entries.count && total>IC_CACHE_MAX_SIZE; ++i) {
+        // may fail if another instance still has it loaded (windows)
+        Nob_Log_Level old = nob_minimal_log_level;
+        nob_minimal_log_level = NOB_NO_LOGS;
+        if (nob_delete_file(entries.items[i].path)) total -= entries.items[i].size;
+        nob_minimal_log_level = old;
     }
 
 end:
-    if (h!=NULL) {
+    nob_da_free(names);
+    nob_da_free(entries);
+    nob_temp_rewind(mark);
+}
+
+// copy under a private name first so readers never see a partial file
+void CacheStore(char const *dir, uint64_t key, char const *builtPath)
+{
+    size_t mark = nob_temp_save();
+    char *path = CachePath(dir, key);
+    char *tmpPath = nob_temp_sprintf("%s.%d.tmp", path, GetPid());
+    Nob_Log_Level old = nob_minimal_log_level;
+    nob_minimal_log_level = NOB_NO_LOGS;
+    if (nob_copy_file(builtPath, tmpPath)) {
+        if (nob_file_exists(path)==1 || !nob_rename(tmpPath, path)) {
+            nob_delete_file(tmpPath);
+        }
+    }
+    nob_minimal_log_level = old;
+    nob_temp_rewind(mark);
+    CacheEvict(dir);
+}
+
+// unload the unit kept by the previous evaluation
+void SessionUnload(Session *ss)
+{
+    if (ss->handle!=NULL) {
     #ifdef _WIN32
-        FreeLibrary(h);
+        FreeLibrary(ss->handle);
     #else
-        dlclose(h);
+        dlclose(ss->handle);
     #endif
+        ss->handle = NULL;
+    }
+    if (ss->liveRawOutPath.count>0) {
+        RemoveOutPath(ss->liveRawOutPath.items);
+        ss->liveRawOutPath.count = 0;
     }
 #ifdef _WIN32
-    for (usz i = 0; i<loadedDlls.count; ++i) {
-        FreeLibrary(loadedDlls.items[i]);
+    for (usz i = 0; i<ss->loadedDlls.count; ++i) {
+        FreeLibrary(ss->loadedDlls.items[i]);
     }
-    nob_da_free(loadedDlls);
-    nob_da_free(full_dlls);
+    ss->loadedDlls.count = 0;
 #endif
-    if (s!=NULL) tcc_delete(s);
-    nob_temp_rewind(mark);
+    if (ss->state!=NULL) {
+        tcc_delete(ss->state);
+        ss->state = NULL;
+    }
+}
 
-    return r;
+void *SessionSymbol(Session *ss, char const *name)
+{
+    if (ss->state!=NULL) return tcc_get_symbol(ss->state, name);
+    if (ss->handle==NULL) return NULL;
+#ifdef _WIN32
+    return (void *)GetProcAddress(ss->handle, name);
+#else
+    return dlsym(ss->handle, name);
+#endif
 }
 
-void AppendLineNum(StrBuilder *sb, usz line)
+// a line of a (sysfs) file, "" if there is none; temp
+char const *ReadFirstLine(char const *path)
+{
+    char line[256] = {0};
+    FILE *f = fopen(path, "r");
+    if (f!=NULL) {
+        if (fgets(line, sizeof(line), f)==NULL) line[0] = '\0';
+        fclose(f);
+    }
+    return nob_temp_sv_to_cstr(nob_sv_trim(nob_sv_from_cstr(line)));
+}
+
+// a cpu cycle at the highest clock, the floor of a real iteration
+double CycleNs(void)
 {
+    static double ns = 0;
+    if (ns>0) return ns;
+    ns = 0.2; // 5GHz when the clock is unknown
+#ifdef __linux__
     size_t mark = nob_temp_save();
-    char *buf = nob_temp_sprintf("#line %zu \"<string>\"\n", line);
-    nob_sb_append_cstr(sb, buf);
+    double khz = atof(ReadFirstLine("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq"));
+    if (khz>0) ns = 1e6/khz;
     nob_temp_rewind(mark);
+#endif
+    return ns;
 }
 
-void AppendTiming(StrBuilder *first, StrBuilder *last, usz line, bool once, StrBuilder *reps, StrBuilder *out)
+// the same sequence as __icSplitMix of the unit
+uint64_t SplitMix(uint64_t *state)
 {
-    first->count = 0;
-    last->count = 0;
-    AppendLineNum(last, 1+line);
+    uint64_t z = (*state += 0x9e3779b97f4a7c15u);
+    z = (z^(z>>30))*0xbf58476d1ce4e5b9u;
+    z = (z^(z>>27))*0x94d049bb133111ebu;
+    return z^(z>>31);
+}
+
+void FixtureFree(struct Fixture *f)
+{
+    if (f->mapped) {
+    #ifndef _WIN32
+        munmap(f->data, f->size);
+    #endif
+    } else {
+        free(f->data);
+    }
+    f->data = NULL;
+    f->size = 0;
+    f->mapped = false;
+}
+
+void FixturesClear(Session *ss)
+{
+    for (usz i = 0; i<ss->fixtures.count; ++i) {
+        FixtureFree(&ss->fixtures.items[i]);
+        free(ss->fixtures.items[i].name);
+        free(ss->fixtures.items[i].path);
+    }
+    ss->fixtures.count = 0;
+}
+
+bool FixtureLoad(struct Fixture *f, struct stat *st)
+{
+    f->mtime = st->st_mtime;
+    f->fileSize = (uint64_t)st->st_size;
+    if (st->st_size==0) {
+        // mmap refuses empty files
+        f->data = malloc(1);
+        return f->data!=NULL;
+    }
 #ifdef _WIN32
-    nob_sb_append_cstr(first, "#include <windows.h>\n");
+    Nob_String_Builder sb = {0};
+    if (!nob_read_entire_file(f->path, &sb)) return false;
+    f->data = sb.items;
+    f->size = sb.count;
 #else
-    nob_sb_append_cstr(first, "#include <time.h>\n");
+    int fd = open(f->path, O_RDONLY);
+    if (fd<0) {
+        printf("fixture %s: could not open %s: %s\n", f->name, f->path, strerror(errno));
+        return false;
+    }
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    // fault it in now, not in the first timed iteration
+    flags |= MAP_POPULATE;
 #endif
-    nob_sb_append_cstr(first, 
-        "static void __icPrintTime(double ns) {"
-        "if      (ns<1e3) printf(\"%.5gns\\n\", ns);"
-        "else if (ns<1e6) printf(\"%.4gus\\n\", ns/1e3);"
-        "else if (ns<1e9) printf(\"%.4gms\\n\", ns/1e6);"
-        "else             printf(\"%.5gs\\n\", ns/1e9);}\n");
-#ifdef _WIN32
-    nob_sb_append_cstr(last, "LARGE_INTEGER __icFreq, __icStart, __icEnd;\n");
-    nob_sb_append_cstr(last, "QueryPerformanceFrequency(&__icFreq);\n");
-    nob_sb_append_cstr(last, "QueryPerformanceCounter(&__icStart);\n");
-#else
-    nob_sb_append_cstr(last, "struct timespec __icStart, __icEnd;\n");
-    nob_sb_append_cstr(last, "clock_gettime(CLOCK_MONOTONIC, &__icStart);\n");
+    void *p = mmap(NULL, (size_t)st->st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (p==MAP_FAILED) {
+        printf("fixture %s: could not map %s: %s\n", f->name, f->path, strerror(errno));
+        return false;
+    }
+    f->data = p;
+    f->size = (size_t)st->st_size;
+    f->mapped = true;
 #endif
-    if (!once) {
-        nob_sb_append_cstr(last, "uint64_t __icReps = (");
-        nob_sb_append_buf(last, reps->items, reps->count);
-        nob_sb_append_cstr(last, ");\n");
-        nob_sb_append_cstr(last, "for (uint64_t __icI = 0; __icI<__icReps; ++__icI) {\n");
+    return true;
+}
+
+bool FixtureGenerate(struct Fixture *f)
+{
+    size_t width = f->kind==FIXTURE_U32? 4: 8;
+    if (f->n>SIZE_MAX/width) {
+        printf("fixture %s: %"PRIu64" elements are too many\n", f->name, f->n);
+        return false;
     }
-    nob_sb_append_buf(last, out->items, out->count);
-    if (!once) {
-        nob_sb_append_cstr(last, "}\n");
+    f->size = (size_t)f->n*width;
+    f->data = malloc(f->size>0? f->size: 1);
+    if (f->data==NULL) {
+        printf("fixture %s: out of memory for %zu bytes\n", f->name, f->size);
+        f->size = 0;
+        return false;
     }
-#ifdef _WIN32
-    nob_sb_append_cstr(last, "QueryPerformanceCounter(&__icEnd);\n");
-    nob_sb_append_cstr(last, "double __icTimeNs = "
-        "1e9 * (__icEnd.QuadPart - __icStart.QuadPart) / __icFreq.QuadPart;\n");
+    uint64_t state = f->seed;
+    for (uint64_t i = 0; i<f->n; ++i) {
+        uint64_t x = SplitMix(&state);
+        switch (f->kind) {
+        case FIXTURE_U32: ((uint32_t *)f->data)[i] = (uint32_t)(x>>32); break;
+        case FIXTURE_U64: ((uint64_t *)f->data)[i] = x; break;
+        default: ((double *)f->data)[i] = (double)(x>>11)*(1.0/9007199254740992.0); break;
+        }
+    }
+    return true;
+}
+
+// the host's __icFixture: one entry per name, kind, n, seed and path, kept
+// until ;fixtures clear; a file is checked once per evaluation, so lookups
+// in a timed loop make no system call; NULL if it can't be made
+void const *FixtureGet(void *ctx, char const *name, int kind, uint64_t n, uint64_t seed,
+    char const *path, size_t *size)
+{
+    Session *ss = ctx;
+    struct Fixture *f = NULL;
+    for (usz i = 0; i<ss->fixtures.count && f==NULL; ++i) {
+        struct Fixture *g = &ss->fixtures.items[i];
+        if ((int)g->kind!=kind || strcmp(g->name, name)!=0) continue;
+        if (kind==FIXTURE_FILE? strcmp(g->path, path)==0: g->n==n && g->seed==seed) f = g;
+    }
+    if (f==NULL) {
+        nob_da_append(&ss->fixtures, ((struct Fixture){
+            .name = strdup(name), .kind = kind, .n = n, .seed = seed,
+            .path = kind==FIXTURE_FILE? strdup(path): NULL,
+        }));
+        f = &nob_da_last(&ss->fixtures);
+        if (kind!=FIXTURE_FILE && !FixtureGenerate(f)) return NULL;
+    }
+    if (kind==FIXTURE_FILE && f->checked!=ss->runCount+1) {
+        f->checked = ss->runCount+1;
+        struct stat st;
+        if (stat(path, &st)!=0) {
+            printf("fixture %s: could not open %s: %s\n", name, path, strerror(errno));
+            FixtureFree(f);
+            return NULL;
+        }
+        // a saved file is reloaded before this evaluation has seen the old
+        // data, the pointers of earlier evaluations went with their unit
+        if (f->data!=NULL && (f->mtime!=st.st_mtime || f->fileSize!=(uint64_t)st.st_size)) FixtureFree(f);
+        if (f->data==NULL && !FixtureLoad(f, &st)) return NULL;
+    }
+    if (size!=NULL) *size = f->size;
+    return f->data;
+}
+
+// resident set size of the process in KiB, 0 if unknown
+usz ResidentKb(void)
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return pmc.WorkingSetSize/1024;
+#elif defined(__linux__)
+    unsigned long size, resident;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f==NULL) return 0;
+    int n = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    if (n!=2) return 0;
+    return resident*(usz)sysconf(_SC_PAGESIZE)/1024;
 #else
-    nob_sb_append_cstr(last, "clock_gettime(CLOCK_MONOTONIC, &__icEnd);\n");
-    nob_sb_append_cstr(last, "double __icTimeNs = "
-        "1e9 * (__icEnd.tv_sec - __icStart.tv_sec) + (__icEnd.tv_nsec - __icStart.tv_nsec);\n");
+    // peak rather than current, the best portable posix offers
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru)!=0) return 0;
+    #ifdef __APPLE__
+    return ru.ru_maxrss/1024;
+    #else
+    return ru.ru_maxrss;
+    #endif
 #endif
-    nob_sb_append_cstr(last, "printf(\"Elapsed time: \");__icPrintTime(__icTimeNs);\n");
-    if (!once) {
-        nob_sb_append_cstr(last, "printf(\"Average time: \");__icPrintTime(__icTimeNs/__icReps);\n");
-    }
 }
 
-void Help(void)
+void GetUsage(struct Usage *u)
 {
-    printf("%s",
-        "Commands:\n"
-        CMD_SIGN"h      -- show this help message\n"
-        CMD_SIGN"q      -- quit\n"
-        CMD_SIGN"l      -- list recorded code\n"
-        CMD_SIGN"c      -- clear recorded code\n"
-        CMD_SIGN"o      -- list current compiler options\n"
-        CMD_SIGN"o[...] -- append new compiler options\n"
-        CMD_SIGN"O      -- clear compiler options\n"
-        CMD_SIGN"a      -- list current arguments\n"
-        CMD_SIGN"a[...] -- append new arguments\n"
-        CMD_SIGN"A      -- clear arguments\n"
-        CMD_SIGN"p expr -- print a struct or array\n"
-        CMD_SIGN"P x,sz -- print memory x with size sz\n"
-        CMD_SIGN"t[:n]  -- time the following statement\n"
-        CMD_SIGN"f      -- start a top level statement\n"
-        CMD_SIGN"m expr -- print out expanded macros\n"
-        CMD_SIGN";      -- rerun the recorded code\n"
-        CMD_SIGN"r[mdc] -- run as memory (m), dll (d) or use cc (c)\n"
-        CMD_SIGN"w      -- warnings as errors (default)\n"
-        CMD_SIGN"W      -- warnings not as errors\n"
-        SHL_SIGN"[...]  -- execute shell command\n"
-        CPP_SIGN"[...]  -- C preprocessor\n"
-        "Macros:\n"
-        "  ONCE_LINE  -- true only the first time on the line\n"
-        "  ONCE       -- execute the following statement only once\n"
-        "  PRINT(X);  -- print the value of X\n"
-        "  BIN(X)     -- get binary representation of integer X\n"
-        "  FORMAT(X, ...)  -- get formatted string\n"
-        "  WIDE(X)    -- format wide string X to a printable string\n"
-    );
+    memset(u, 0, sizeof(*u));
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        // 100ns units
+        u->utimeNs = (((uint64_t)user.dwHighDateTime<<32) | user.dwLowDateTime)*100;
+        u->stimeNs = (((uint64_t)kernel.dwHighDateTime<<32) | kernel.dwLowDateTime)*100;
+    }
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        u->maxrssKb = (long)(pmc.PeakWorkingSetSize/1024);
+        u->minflt = (long)pmc.PageFaultCount;
+    }
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru)!=0) return;
+    u->utimeNs = (uint64_t)ru.ru_utime.tv_sec*1000000000 + (uint64_t)ru.ru_utime.tv_usec*1000;
+    u->stimeNs = (uint64_t)ru.ru_stime.tv_sec*1000000000 + (uint64_t)ru.ru_stime.tv_usec*1000;
+    #ifdef __APPLE__
+    u->maxrssKb = ru.ru_maxrss/1024;
+    #else
+    u->maxrssKb = ru.ru_maxrss;
+    #endif
+    u->minflt = ru.ru_minflt;
+    u->majflt = ru.ru_majflt;
+    u->nvcsw = ru.ru_nvcsw;
+    u->nivcsw = ru.ru_nivcsw;
+#endif
 }
 
-void CompleteFunc(char const *buf, int cursorPos, mlCompletions *comp, void *userdata)
+// b-a into a
+void UsageDelta(struct Usage *a, struct Usage const *b)
 {
-    static char const *const cpp[] = {
-        "define", "undef", "if", "ifdef", "ifndef", "else", "elif", "endif",
-        "include", "embed", "line", "error", "pragma",
-    };
+    a->utimeNs = b->utimeNs-a->utimeNs;
+    a->stimeNs = b->stimeNs-a->stimeNs;
+    a->maxrssKb = b->maxrssKb-a->maxrssKb;
+    a->minflt = b->minflt-a->minflt;
+    a->majflt = b->majflt-a->majflt;
+    a->nvcsw = b->nvcsw-a->nvcsw;
+    a->nivcsw = b->nivcsw-a->nivcsw;
+}
 
-    static char const *const keywords[] = {
-        "if", "else", 
-        "for", "do", "while",
-        "switch", "case", "default", 
-        "return", "goto", "auto",
-    };
+// IC_TRACE=file appends a json line per evaluation,
+// IC_TRACE_FORMAT=chrome writes trace events for chrome://tracing or perfetto
+FILE *traceFile = NULL;
+bool traceChecked = false;
+bool traceChrome = false;
 
-    static char const *const stmtLike[] = {
-        "break", "continue",
-    };
+char const *runTypeNames[] = {"mem", "dll", "cc"};
 
-    static char const *const typeLike[] = {
-        "int", "char", "float", "double", "void", "short", "long", "signed",
-        "unsigned", "struct", "union", "enum", "const", "volatile", "static",
-        "extern", "register", "inline", "restrict",
-        // C11
-        "bool",
-        // known types
-        "size_t", "ssize_t", "wchar_t",
-        "int8_t", "int16_t", "int32_t", "int64_t",
-        "uint8_t", "uint16_t", "uint32_t", "uint64_t",
-        // stdint.h
-        "intmax_t", "intptr_t", "uintmax_t", "uintptr_t",
-        // defined by me
-        "ONCE",
+// NULL when not tracing
+FILE *TraceFile(void)
+{
+    if (!traceChecked) {
+        traceChecked = true;
+        char const *path = getenv("IC_TRACE");
+        if (path==NULL || *path=='\0') return NULL;
+        char const *format = getenv("IC_TRACE_FORMAT");
+        traceChrome = format!=NULL && strcmp(format, "chrome")==0;
+        traceFile = fopen(path, "a");
+        if (traceFile==NULL) {
+            nob_log(NOB_ERROR, "could not open IC_TRACE %s: %s", path, strerror(errno));
+            return NULL;
+        }
+        // the array format, the viewers accept it without the closing bracket
+        if (traceChrome && ftell(traceFile)==0) fprintf(traceFile, "[\n");
+    }
+    return traceFile;
+}
+
+void TraceEval(struct EvalStats *st, char const *conditions)
+{
+    if (TraceFile()==NULL) return;
+    if (traceChrome) {
+        long pid = (long)GetPid();
+        fprintf(traceFile, "{\"name\":\"eval %zu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":0,"
+            "\"args\":{\"rt\":\"%s\",\"ok\":%s,\"cached\":%s,\"src_bytes\":%zu,\"rss_kb\":%zu,"
+            "\"minflt\":%ld,\"majflt\":%ld,\"nvcsw\":%ld,\"nivcsw\":%ld}},\n",
+            st->eval, st->at[PH_INPUT]/1e3, st->total/1e3, pid, runTypeNames[st->rt],
+            st->ok? "true": "false", st->cached? "true": "false", st->srcBytes, st->rssKb,
+            st->usage.minflt, st->usage.majflt, st->usage.nvcsw, st->usage.nivcsw);
+        for (int p = 0; p<PH_COUNT; ++p) {
+            if (st->ns[p]==0) continue;
+            fprintf(traceFile, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":0},\n",
+                phaseNames[p], st->at[p]/1e3, st->ns[p]/1e3, pid);
+        }
+    } else {
+        fprintf(traceFile, "{\"eval\":%zu,\"rt\":\"%s\",\"ok\":%s,\"cached\":%s,\"src_bytes\":%zu,\"rss_kb\":%zu",
+            st->eval, runTypeNames[st->rt], st->ok? "true": "false", st->cached? "true": "false",
+            st->srcBytes, st->rssKb);
+        for (int p = 0; p<PH_COUNT; ++p) {
+            fprintf(traceFile, ",\"%s_ns\":%"PRIu64, phaseNames[p], st->ns[p]);
+        }
+        struct Usage *u = &st->usage;
+        fprintf(traceFile, ",\"total_ns\":%"PRIu64",\"utime_ns\":%"PRIu64",\"stime_ns\":%"PRIu64
+            ",\"maxrss_growth_kb\":%ld,\"minflt\":%ld,\"majflt\":%ld,\"nvcsw\":%ld,\"nivcsw\":%ld,\"conditions\":\"%s\"}\n",
+            st->total, u->utimeNs, u->stimeNs, u->maxrssKb, u->minflt, u->majflt, u->nvcsw, u->nivcsw, conditions);
+    }
+    // server workers leave with _exit
+    fflush(traceFile);
+}
+
+void RecordEval(Session *ss, struct EvalStats *st)
+{
+    st->eval = ss->runCount;
+    st->total = 0;
+    for (int p = 0; p<PH_COUNT; ++p) st->total += st->ns[p];
+    st->rssKb = ResidentKb();
+    ss->stats[ss->statsCount%IC_STATS_MAX] = *st;
+    ss->statsCount += 1;
+    TraceEval(st, ss->quiet.conditions);
+}
+
+// temp
+char *FormatNs(double ns)
+{
+    if      (ns<1e3) return nob_temp_sprintf("%.4gns", ns);
+    else if (ns<1e6) return nob_temp_sprintf("%.4gus", ns/1e3);
+    else if (ns<1e9) return nob_temp_sprintf("%.4gms", ns/1e6);
+    else             return nob_temp_sprintf("%.4gs", ns/1e9);
+}
+
+// temp
+char *FormatBytes(double bytes)
+{
+    if      (bytes<1024.0)   return nob_temp_sprintf("%.0fB", bytes);
+    else if (bytes<1048576.0) return nob_temp_sprintf("%.4gKiB", bytes/1024.0);
+    else if (bytes<1073741824.0) return nob_temp_sprintf("%.4gMiB", bytes/1048576.0);
+    else                     return nob_temp_sprintf("%.4gGiB", bytes/1073741824.0);
+}
+
+// 100, 2.5us, 10ms, 1s; plain numbers are milliseconds
+bool ParseDuration(Nob_String_View sv, double *ns)
+{
+    size_t mark = nob_temp_save();
+    char const *s = nob_temp_sv_to_cstr(sv);
+    char *end;
+    double x = strtod(s, &end);
+    bool ok = end!=s && x>=0;
+    if      (strcmp(end, "ns")==0) *ns = x;
+    else if (strcmp(end, "us")==0) *ns = x*1e3;
+    else if (strcmp(end, "ms")==0 || *end=='\0') *ns = x*1e6;
+    else if (strcmp(end, "s")==0)  *ns = x*1e9;
+    else ok = false;
+    nob_temp_rewind(mark);
+    return ok;
+}
+
+// 1,2,4,8
+bool ParseThreadCounts(Nob_String_View list, struct TimeOptions *to)
+{
+    to->threadsCount = 0;
+    while (list.count>0) {
+        Nob_String_View num = nob_sv_chop_by_delim(&list, ',');
+        size_t mark = nob_temp_save();
+        int n = atoi(nob_temp_sv_to_cstr(num));
+        nob_temp_rewind(mark);
+        if (n<1 || n>IC_THREADS_MAX || to->threadsCount==NOB_ARRAY_LEN(to->threads)) {
+            printf("Thread counts of \""CMD_SIGN"t@\" are 1 to %d, up to %zu of them\n",
+                IC_THREADS_MAX, NOB_ARRAY_LEN(to->threads));
+            return false;
+        }
+        to->threads[to->threadsCount++] = n;
+    }
+    return to->threadsCount>0;
+}
+
+bool IsValidSessionName(Nob_String_View name)
+{
+    if (name.count==0 || name.data[0]=='.') return false;
+    for (usz i = 0; i<name.count; ++i) {
+        char c = name.data[i];
+        if (c=='/' || c=='\\' || c==':' || isspace((unsigned char)c)) return false;
+    }
+    return true;
+}
+
+// sv follows ";t", the reps expression goes to reps (NULL: none expected)
+bool ParseTimeOptions(Nob_String_View sv, struct TimeOptions *to, StrBuilder *reps)
+{
+    sv = nob_sv_trim(sv);
+    *to = (struct TimeOptions){
+        .warmupNs = 100e6,
+        .minTimeNs = 10e6,
+        .maxTimeNs = 5e9,
+        .samples = 20,
     };
+    if (reps!=NULL) reps->count = 0;
+    if (reps!=NULL && nob_sv_chop_prefix(&sv, nob_sv_from_cstr(":"))) {
+        // the expression ends at the first option
+        usz n = 0;
+        for (; n+1<sv.count; ++n) {
+            if (sv.data[n]=='-' && sv.data[n+1]=='-' && (n==0 || isspace((unsigned char)sv.data[n-1]))) break;
+        }
+        if (n+1>=sv.count) n = sv.count;
+        Nob_String_View expr = nob_sv_trim(nob_sv_chop_left(&sv, n));
+        nob_sb_append_buf(reps, expr.data, expr.count);
+    }
+    to->once = reps==NULL || reps->count==0;
+    if (nob_sv_chop_prefix(&sv, nob_sv_from_cstr("@"))) {
+        Nob_String_View list = nob_sv_chop_by_delim(&sv, ' ');
+        if (!ParseThreadCounts(list, to)) return false;
+        sv = nob_sv_trim_left(sv);
+    }
+    while (sv.count>0) {
+        Nob_String_View word;
+        if (nob_sv_starts_with(sv, nob_sv_from_cstr("--bytes=")) || nob_sv_starts_with(sv, nob_sv_from_cstr("--items="))) {
+            // an expression, up to the next option
+            usz n = 0;
+            while (n<sv.count && !(n>0 && isspace((unsigned char)sv.data[n-1]) && sv.data[n]=='-' && n+1<sv.count && sv.data[n+1]=='-')) ++n;
+            word = nob_sv_trim(nob_sv_chop_left(&sv, n));
+        } else {
+            word = nob_sv_chop_by_delim(&sv, ' ');
+        }
+        sv = nob_sv_trim_left(sv);
+        if (word.count==0) continue;
+        Nob_String_View value = word;
+        Nob_String_View name = nob_sv_chop_by_delim(&value, '=');
+        bool ok = true;
+        if (nob_sv_eq(word, nob_sv_from_cstr("--rusage"))) {
+            to->rusage = true;
+        } else if (nob_sv_eq(word, nob_sv_from_cstr("--bench"))) {
+            to->bench = true;
+        } else if (nob_sv_eq(name, nob_sv_from_cstr("--warmup"))) {
+            ok = ParseDuration(value, &to->warmupNs);
+            to->bench = true;
+        } else if (nob_sv_eq(name, nob_sv_from_cstr("--min-time"))) {
+            ok = ParseDuration(value, &to->minTimeNs);
+            to->bench = true;
+        } else if (nob_sv_eq(name, nob_sv_from_cstr("--max-time"))) {
+            ok = ParseDuration(value, &to->maxTimeNs);
+            to->bench = true;
+        } else if (nob_sv_eq(name, nob_sv_from_cstr("--perf"))) {
+            if (nob_sv_eq(word, name)) value = nob_sv_from_cstr(IC_PERF_DEFAULT);
+            to->perfEvents = 0;
+            while (ok && value.count>0) {
+                Nob_String_View event = nob_sv_chop_by_delim(&value, ',');
+                usz i = 0;
+                while (i<IC_PERF_MAX && !nob_sv_eq(event, nob_sv_from_cstr(perfEventNames[i]))) ++i;
+                ok = i<IC_PERF_MAX;
+                if (ok) to->perfEvents |= 1u<<i;
+            }
+            if (!ok) printf("Counters: "IC_PERF_DEFAULT",\n  branches, cache-references, cache-misses, L1-dcache-loads, LLC-loads, dTLB-load-misses\n");
+        } else if (nob_sv_eq(name, nob_sv_from_cstr("--bytes")) || nob_sv_eq(name, nob_sv_from_cstr("--items"))) {
+            char *expr = name.data[2]=='b'? to->bytes: to->items;
+            ok = value.count>0 && value.count<sizeof(to->bytes);
+            if (ok) snprintf(expr, sizeof(to->bytes), SV_Fmt, SV_Arg(value));
+        } else if (nob_sv_eq(name, nob_sv_from_cstr("--threads"))) {
+            if (!ParseThreadCounts(value, to)) return false;
+        } else if (nob_sv_eq(name, nob_sv_from_cstr("--save")) || nob_sv_eq(name, nob_sv_from_cstr("--compare"))) {
+            // --save=name or --save name
+            if (nob_sv_eq(word, name)) {
+                value = nob_sv_chop_by_delim(&sv, ' ');
+                sv = nob_sv_trim_left(sv);
+            }
+            char *store = name.data[2]=='s'? to->save: to->compare;
+            ok = IsValidSessionName(value) && value.count<sizeof(to->save);
+            if (ok) snprintf(store, sizeof(to->save), SV_Fmt, SV_Arg(value));
+            to->bench = true;
+        } else if (nob_sv_eq(name, nob_sv_from_cstr("--samples"))) {
+            size_t mark = nob_temp_save();
+            long n = strtol(nob_temp_sv_to_cstr(value), NULL, 10);
+            nob_temp_rewind(mark);
+            ok = n>=2;
+            to->samples = ok? (usz)n: 0;
+            to->bench = true;
+        } else {
+            printf("Unknown option of \""CMD_SIGN"t\": "SV_Fmt"\n", SV_Arg(word));
+            return false;
+        }
+        if (!ok) {
+            printf("Bad value of \""CMD_SIGN"t\" option: "SV_Fmt"\n", SV_Arg(word));
+            return false;
+        }
+    }
+    return true;
+}
 
-    static char const *const funcLike[] = {
-        // standard functions
-        "printf", "scanf", "malloc", "free", "realloc", "calloc",
-        "memcpy", "memset", "puts", "putchar",
-        "atoi", "atol", "atoll", "strtol", "strtoll",
-        "strtoul", "strtoull", "strcpy", "strncpy", "strlen",
-        // math functions
-        "sin", "cos", "tan", "asin", "acos", "atan", "atan2",
-        "exp", "pow", "log", "sqrt", "cbrt", "lgamma", "tgamma",
-        "abs", "labs", "llabs", "fabs", "fmod", "fmin", "fmax",
-        "ceil", "floor", "round", "trunc",
-        // inttypes.h
-        "INT8_C", "INT16_C", "INT32_C", "INT64_C",
-        "UINT8_C", "UINT16_C", "UINT32_C", "UINT64_C",
-        // others
-        "sizeof", "alignof", "alignas",
-        // defined by me
-        "BIN", "FORMAT", "WIDE", "PRINT",
+// the options handed to BenchStart() by the unit
+void FormatTimeOptions(struct TimeOptions *to, StrBuilder *sb)
+{
+    nob_sb_appendf(sb, "--warmup=%.17gns --min-time=%.17gns --max-time=%.17gns --samples=%zu",
+        to->warmupNs, to->minTimeNs, to->maxTimeNs, to->samples);
+    if (to->threadsCount>0) {
+        nob_sb_append_cstr(sb, " --threads=");
+        for (usz i = 0; i<to->threadsCount; ++i) {
+            nob_sb_appendf(sb, "%s%d", i>0? ",": "", to->threads[i]);
+        }
+    }
+    if (to->save[0]!='\0') nob_sb_appendf(sb, " --save=%s", to->save);
+    if (to->compare[0]!='\0') nob_sb_appendf(sb, " --compare=%s", to->compare);
+    if (to->perfEvents!=0) {
+        char const *sep = " --perf=";
+        for (usz i = 0; i<IC_PERF_MAX; ++i) {
+            if (!(to->perfEvents & 1u<<i)) continue;
+            nob_sb_appendf(sb, "%s%s", sep, perfEventNames[i]);
+            sep = ",";
+        }
+    }
+}
+
+int DoubleCmp(void const *a, void const *b)
+{
+    double x = *(double const *)a, y = *(double const *)b;
+    return (x > y) - (x < y);
+}
+
+// nearest rank of sorted values
+double PercentileOf(double *sorted, usz n, double p)
+{
+    usz i = (usz)(p*n+0.999999);
+    return sorted[i>0? i-1: 0];
+}
+
+// linear interpolation between the closest ranks
+double QuantileOf(double *sorted, usz n, double q)
+{
+    double pos = q*(n-1);
+    usz i = (usz)pos;
+    if (i+1>=n) return sorted[n-1];
+    return sorted[i] + (pos-i)*(sorted[i+1]-sorted[i]);
+}
+
+// two sided 95% quantile of student's t
+double StudentT95(usz df)
+{
+    static double t[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
     };
+    if (df==0) return 0;
+    if (df<=NOB_ARRAY_LEN(t)) return t[df-1];
+    return df<60? 2.0: df<120? 1.98: 1.96;
+}
 
-    static char const *const constLike[] = {
-        "NULL", "true", "false",
-        "SIZE_MAX", "WCHAR_MAX", "WCHAR_MIN",
-        "CHAR_BIT", "SCHAR_MAX", "SCHAR_MIN", "UCHAR_MAX",
-        // inttypes.h
-        "INT8_MAX", "INT16_MAX", "INT32_MAX", "INT64_MAX",
-        "INT8_MIN", "INT16_MIN", "INT32_MIN", "INT64_MIN",
-        "UINT8_MAX", "UINT16_MAX", "UINT32_MAX", "UINT64_MAX",
-        "PRId8", "PRId16", "PRId32", "PRId64", "PRIdPTR",
-        "PRIu8", "PRIu16", "PRIu32", "PRIu64", "PRIuPTR",
-        "PRIx8", "PRIx16", "PRIx32", "PRIx64", "PRIxPTR",
-        "SCNd8", "SCNd16", "SCNd32", "SCNd64", "SCNdPTR",
-        "SCNu8", "SCNu16", "SCNu32", "SCNu64", "SCNuPTR",
-        "SCNx8", "SCNx16", "SCNx32", "SCNx64", "SCNxPTR",
-        // float.h
-        "FLT_MAX", "FLT_MIN", "DBL_MAX", "DBL_MIN", "LDBL_MAX", "LDBL_MIN",
-        "FLT_EPSILON", "DBL_EPSILON", "LDBL_EPSILON",
+// temp
+char *FormatRate(double perSecond, char const *unit)
+{
+    if      (perSecond<1e3) return nob_temp_sprintf("%.4g%s/s", perSecond, unit);
+    else if (perSecond<1e6) return nob_temp_sprintf("%.4gk%s/s", perSecond/1e3, unit);
+    else if (perSecond<1e9) return nob_temp_sprintf("%.4gM%s/s", perSecond/1e6, unit);
+    else if (perSecond<1e12) return nob_temp_sprintf("%.4gG%s/s", perSecond/1e9, unit);
+    else                     return nob_temp_sprintf("%.4gT%s/s", perSecond/1e12, unit);
+}
+
+// temp, throughput of an iteration taking ns
+char *FormatThroughput(double bytes, double items, double ns)
+{
+    if (ns<=0) return "";
+    if (bytes>0 && items>0) {
+        char *b = FormatRate(bytes*1e9/ns, "B");
+        return nob_temp_sprintf("%s, %s", b, FormatRate(items*1e9/ns, " items"));
+    }
+    if (bytes>0) return FormatRate(bytes*1e9/ns, "B");
+    if (items>0) return FormatRate(items*1e9/ns, " items");
+    return "";
+}
+
+struct SampleStats {
+    usz n;
+    double min, median, mean, p90, p99, max;
+    double sd, ci; // ci: half width of the 95% interval of the mean
+    usz mild, severe; // outliers
+};
+
+// sorts x
+void SampleStatsOf(double *x, usz n, struct SampleStats *st)
+{
+    qsort(x, n, sizeof(*x), DoubleCmp);
+    memset(st, 0, sizeof(*st));
+    st->n = n;
+    if (n==0) return;
+    for (usz i = 0; i<n; ++i) st->mean += x[i];
+    st->mean /= n;
+    double var = 0;
+    for (usz i = 0; i<n; ++i) var += (x[i]-st->mean)*(x[i]-st->mean);
+    st->sd = n>1? sqrt(var/(n-1)): 0;
+    st->ci = StudentT95(n-1)*st->sd/sqrt(n);
+    st->min = x[0];
+    st->max = x[n-1];
+    st->median = QuantileOf(x, n, 0.5);
+    st->p90 = PercentileOf(x, n, 0.9);
+    st->p99 = PercentileOf(x, n, 0.99);
+    // tukey's fences
+    double q1 = QuantileOf(x, n, 0.25), q3 = QuantileOf(x, n, 0.75), iqr = q3-q1;
+    for (usz i = 0; i<n; ++i) {
+        if      (x[i]<q1-3*iqr   || x[i]>q3+3*iqr)   st->severe += 1;
+        else if (x[i]<q1-1.5*iqr || x[i]>q3+1.5*iqr) st->mild += 1;
+    }
+}
+
+struct RankedSample {
+    double v;
+    bool isX;
+};
+
+int RankedSampleCmp(void const *a, void const *b)
+{
+    return DoubleCmp(&((struct RankedSample const *)a)->v, &((struct RankedSample const *)b)->v);
+}
+
+// two sided p value of the mann-whitney u test, normal approximation with ties
+double MannWhitneyP(double const *x, usz nx, double const *y, usz ny)
+{
+    usz n = nx+ny;
+    if (nx==0 || ny==0) return 1;
+    struct RankedSample *all = malloc(n*sizeof(*all));
+    assert(all!=NULL);
+    for (usz i = 0; i<nx; ++i) all[i] = (struct RankedSample){x[i], true};
+    for (usz i = 0; i<ny; ++i) all[nx+i] = (struct RankedSample){y[i], false};
+    qsort(all, n, sizeof(*all), RankedSampleCmp);
+    double rankX = 0, ties = 0;
+    for (usz i = 0; i<n;) {
+        usz j = i;
+        while (j<n && all[j].v==all[i].v) ++j;
+        double rank = (i+1+j)/2.0, t = (double)(j-i);
+        for (usz k = i; k<j; ++k) if (all[k].isX) rankX += rank;
+        ties += t*t*t-t;
+        i = j;
+    }
+    free(all);
+    double u = rankX - nx*(nx+1)/2.0;
+    double mu = nx*ny/2.0;
+    double sigma = sqrt(nx*ny/12.0*((n+1) - ties/((double)n*(n-1))));
+    if (sigma==0) return 1;
+    double z = (fabs(u-mu)-0.5)/sigma;
+    if (z<0) z = 0;
+    return erfc(z/sqrt(2));
+}
+
+// a json line per variant to IC_TRACE
+void BenchTrace(struct Bench *b, struct SampleStats *st)
+{
+    FILE *f = TraceFile();
+    if (f==NULL || traceChrome) return;
+    for (usz v = 0; v<b->count; ++v) {
+        fprintf(f, "{\"bench\":\"%s\",\"samples\":%zu,\"reps\":%"PRIu64",\"min_ns\":%.17g,\"median_ns\":%.17g,"
+            "\"mean_ns\":%.17g,\"p90_ns\":%.17g,\"p99_ns\":%.17g,\"stddev_ns\":%.17g,\"ci95_ns\":%.17g,"
+            "\"outliers\":%zu,\"bytes_per_s\":%.17g,\"items_per_s\":%.17g,\"conditions\":\"%s\"}\n",
+            b->variants[v].label, st[v].n, b->variants[v].reps, st[v].min, st[v].median, st[v].mean,
+            st[v].p90, st[v].p99, st[v].sd, st[v].ci, st[v].mild+st[v].severe,
+            st[v].median>0? b->bytes*1e9/st[v].median: 0, st[v].median>0? b->items*1e9/st[v].median: 0,
+            b->conditions!=NULL? b->conditions: "");
+    }
+    fflush(f);
+}
+
+// an iteration faster than a cycle did not do the work it shows
+void BenchWarnCycle(char const *label)
+{
+    printf("  warning: %s%sless than a cpu cycle (%s) per iteration, the optimizer probably removed"
+        " the work, KEEP(x) its result\n", label, label[0]!='\0'? ": ": "", FormatNs(CycleNs()));
+}
+
+void BenchReport(struct Bench *b)
+{
+    size_t mark = nob_temp_save();
+    struct SampleStats st[IC_BENCH_MAX];
+    for (usz v = 0; v<b->count; ++v) {
+        SampleStatsOf(b->variants[v].samples.items, b->variants[v].samples.count, &st[v]);
+    }
+    if (b->count==1) {
+        printf("%zu samples of %"PRIu64" reps after %s of warmup\n", st[0].n, b->variants[0].reps, FormatNs(b->warmupNs));
+        printf("  min %s  median %s  mean %s  p90 %s  p99 %s\n", FormatNs(st[0].min),
+            FormatNs(st[0].median), FormatNs(st[0].mean), FormatNs(st[0].p90), FormatNs(st[0].p99));
+        printf("  stddev %s (%.2g%%)  95%% ci of the mean %s .. %s\n", FormatNs(st[0].sd),
+            st[0].mean>0? 100*st[0].sd/st[0].mean: 0.0, FormatNs(st[0].mean-st[0].ci), FormatNs(st[0].mean+st[0].ci));
+        if (st[0].mild+st[0].severe>0) {
+            printf("  outliers: %zu mild, %zu severe%s\n", st[0].mild, st[0].severe,
+                st[0].severe*10>=st[0].n? ", the results are noisy": "");
+        }
+        if (b->bytes>0 || b->items>0) {
+            printf("  throughput %s at the median\n", FormatThroughput(b->bytes, b->items, st[0].median));
+        }
+        if (st[0].median<CycleNs()) BenchWarnCycle(b->variants[0].label);
+        if (b->conditions!=NULL) printf("  conditions: %s\n", b->conditions);
+        BenchTrace(b, st);
+        nob_temp_rewind(mark);
+        return;
+    }
+    if (b->hold) printf("%zu samples per configuration, run one after another with %s of warmup\n", st[0].n, FormatNs(b->warmupNs));
+    else printf("%zu interleaved rounds after %s of warmup\n", st[0].n, FormatNs(b->warmupNs));
+    int w = 12;
+    for (usz v = 0; v<b->count; ++v) {
+        if ((int)strlen(b->variants[v].label)>w) w = (int)strlen(b->variants[v].label);
+    }
+    printf("  %-*s %10s %21s %10s %9s  vs %s\n", w, "", "median", "mean +- 95% ci", "min", "outliers", b->variants[0].label);
+    for (usz v = 0; v<b->count; ++v) {
+        printf("  %-*s %10s %10s +- %-8s %10s %9zu", w, b->variants[v].label, FormatNs(st[v].median),
+            FormatNs(st[v].mean), FormatNs(st[v].ci), FormatNs(st[v].min), st[v].mild+st[v].severe);
+        if (b->bytes>0 || b->items>0) printf("  %s", FormatThroughput(b->bytes, b->items, st[v].median));
+        if (v>0) {
+            double p = MannWhitneyP(b->variants[0].samples.items, b->variants[0].samples.count,
+                b->variants[v].samples.items, b->variants[v].samples.count);
+            double speedup = st[v].median>0? st[0].median/st[v].median: 0;
+            if (p<0.05) {
+                printf("  %.3gx %s (p=%.2g)", speedup>=1? speedup: 1/speedup, speedup>=1? "faster": "slower", p);
+            } else {
+                printf("  no significant difference (p=%.2g)", p);
+            }
+        }
+        printf("\n");
+    }
+    for (usz v = 0; v<b->count; ++v) {
+        if (st[v].median<CycleNs()) BenchWarnCycle(b->variants[v].label);
+    }
+    if (b->conditions!=NULL) printf("  conditions: %s\n", b->conditions);
+    BenchTrace(b, st);
+    nob_temp_rewind(mark);
+}
+
+// called by a ;t --bench or ;bench unit before its first batch;
+// labels of the variants are separated by \n, returns the reps of the batch of *variant
+uint64_t BenchStart(void *ctx, char const *options, char const *labels, uint64_t reps, int *variant)
+{
+    Session *ss = ctx;
+    struct Bench *b = &ss->bench;
+    if (!ParseTimeOptions(nob_sv_from_cstr(options), &b->opts, NULL)) return 0;
+    b->active = true;
+    b->phase = BENCH_WARMUP;
+    b->fixedReps = reps>0;
+    b->begin = nob_nanos_since_unspecified_epoch();
+    b->warmupNs = 0;
+    b->seed = b->begin|1;
+    b->count = 0;
+    b->conditions = ss->quiet.on? ss->quiet.conditions: NULL;
+    Nob_String_View sv = nob_sv_from_cstr(labels);
+    do {
+        Nob_String_View label = nob_sv_chop_by_delim(&sv, '\n');
+        struct BenchVariant *v = &b->variants[b->count++];
+        snprintf(v->label, sizeof(v->label), SV_Fmt, SV_Arg(label));
+        v->reps = reps>0? reps: 1;
+        v->samples.count = 0;
+    } while (sv.count>0 && b->count<IC_BENCH_MAX);
+    b->current = 0;
+    *variant = 0;
+    return b->variants[0].reps;
+}
+
+// grows reps toward a batch of minTimeNs, at most 10x at once
+uint64_t BenchScale(struct Bench *b, uint64_t reps, double ns)
+{
+    if (b->fixedReps || ns>=b->opts.minTimeNs || reps>=(uint64_t)1<<40) return reps;
+    double mult = ns>0? b->opts.minTimeNs*1.4/ns: 10;
+    if (mult>10) mult = 10;
+    uint64_t next = (uint64_t)(reps*mult);
+    return next>reps? next: reps+1;
+}
+
+// a sampling round in a new random order, against drift and order effects
+void BenchRound(struct Bench *b)
+{
+    for (usz i = 0; i<b->count; ++i) b->order[i] = i;
+    for (usz i = b->count; i>1; --i) {
+        // xorshift
+        b->seed ^= b->seed<<13;
+        b->seed ^= b->seed>>7;
+        b->seed ^= b->seed<<17;
+        usz j = b->seed%i, t = b->order[i-1];
+        b->order[i-1] = b->order[j];
+        b->order[j] = t;
+    }
+    b->orderPos = 0;
+    b->current = b->order[0];
+}
+
+void BenchStore(Session *ss);
+
+// after each batch of reps iterations that took ns,
+// returns the reps of the next batch of *variant or 0 when done
+uint64_t BenchNext(void *ctx, int *variant, uint64_t reps, double ns)
+{
+    Session *ss = ctx;
+    struct Bench *b = &ss->bench;
+    struct BenchVariant *v = &b->variants[b->current];
+    uint64_t now = nob_nanos_since_unspecified_epoch();
+    double elapsed = (double)(now-b->begin);
+    switch (b->phase) {
+    case BENCH_WARMUP:
+        v->reps = BenchScale(b, reps, ns);
+        if (elapsed<b->opts.warmupNs) {
+            b->current = (b->current+1)%b->count;
+            break;
+        }
+        b->warmupNs = elapsed;
+        b->phase = BENCH_CALIBRATE;
+        b->current = 0;
+        break;
+    case BENCH_CALIBRATE:
+        v->reps = BenchScale(b, reps, ns);
+        if (v->reps!=reps) break;
+        if (b->current+1<b->count) {
+            b->current += 1;
+            break;
+        }
+        b->phase = BENCH_SAMPLE;
+        b->begin = now;
+        BenchRound(b);
+        break;
+    case BENCH_SAMPLE: {
+        nob_da_append(&v->samples, ns/reps);
+        if (++b->orderPos<b->count) {
+            b->current = b->order[b->orderPos];
+            break;
+        }
+        usz fewest = b->variants[0].samples.count;
+        for (usz i = 1; i<b->count; ++i) {
+            if (b->variants[i].samples.count<fewest) fewest = b->variants[i].samples.count;
+        }
+        if (fewest>=b->opts.samples || (elapsed>b->opts.maxTimeNs && fewest>=3)) {
+            b->active = false;
+            if (!b->hold) {
+                BenchReport(b);
+                // with counters after PerfClose()
+                if (b->opts.perfEvents!=0 && ss->perf.count>0) {
+                    b->storePending = true;
+                } else {
+                    BenchStore(ss);
+                    b->bytes = b->items = 0;
+                }
+            }
+            fflush(stdout);
+            return 0;
+        }
+        BenchRound(b);
+        break;
+    }
+    }
+    *variant = (int)b->current;
+    return b->variants[b->current].reps;
+}
+
+#ifdef __linux__
+void PerfConfig(int event, struct perf_event_attr *pe)
+{
+    static struct { uint32_t type; uint64_t config; } configs[IC_PERF_MAX] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ<<8 | PERF_COUNT_HW_CACHE_RESULT_ACCESS<<16},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ<<8 | PERF_COUNT_HW_CACHE_RESULT_MISS<<16},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ<<8 | PERF_COUNT_HW_CACHE_RESULT_ACCESS<<16},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ<<8 | PERF_COUNT_HW_CACHE_RESULT_MISS<<16},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ<<8 | PERF_COUNT_HW_CACHE_RESULT_MISS<<16},
     };
+    memset(pe, 0, sizeof(*pe));
+    pe->size = sizeof(*pe);
+    pe->type = configs[event].type;
+    pe->config = configs[event].config;
+    pe->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // user space only, allowed up to perf_event_paranoid 2
+    pe->exclude_kernel = 1;
+    pe->exclude_hv = 1;
+}
+#endif
+
+void PerfCloseFds(struct Perf *pf)
+{
+#ifdef __linux__
+    for (usz i = 0; i<pf->count; ++i) {
+        if (pf->fds[i]>=0) close(pf->fds[i]);
+    }
+#endif
+    pf->count = 0;
+    pf->on = false;
+}
+
+// called by a ;t --perf unit before timing, returns 0 if there are no counters
+int PerfOpen(void *ctx, uint32_t events)
+{
+    Session *ss = ctx;
+    struct Perf *pf = &ss->perf;
+    PerfCloseFds(pf);
+    pf->reps = 0;
+    pf->counted = 0;
+#ifdef __linux__
+    int leader = -1;
+    for (usz i = 0; i<IC_PERF_MAX; ++i) {
+        if (!(events & 1u<<i)) continue;
+        struct perf_event_attr pe;
+        PerfConfig((int)i, &pe);
+        pe.disabled = leader<0;
+        int fd = (int)syscall(SYS_perf_event_open, &pe, 0, -1, leader, 0);
+        if (fd<0 && leader<0) {
+            if (errno==EACCES || errno==EPERM) {
+                int paranoid = -1;
+                FILE *f = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+                if (f!=NULL) {
+                    if (fscanf(f, "%d", &paranoid)!=1) paranoid = -1;
+                    fclose(f);
+                }
+                printf("Counters are not permitted, kernel.perf_event_paranoid is %d (needs 2 or less)\n", paranoid);
+            } else {
+                printf("Hardware counters are not available (%s), e.g. in a VM without a virtual PMU\n", strerror(errno));
+            }
+            return 0;
+        }
+        if (fd<0) {
+            printf("Counter %s is not available: %s\n", perfEventNames[i], strerror(errno));
+            continue;
+        }
+        if (leader<0) leader = fd;
+        pf->fds[pf->count] = fd;
+        pf->events[pf->count] = (int)i;
+        pf->count += 1;
+    }
+    if (pf->count==0) return 0;
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    return 1;
+#else
+    (void)events;
+    printf("Hardware counters need perf_event_open of linux\n");
+    return 0;
+#endif
+}
+
+// around every timed loop; during ;t --bench only the samples count
+void PerfToggle(void *ctx, int on, uint64_t reps)
+{
+    Session *ss = ctx;
+    struct Perf *pf = &ss->perf;
+    if (pf->count==0) return;
+    if (on && ss->bench.active && ss->bench.phase!=BENCH_SAMPLE) return;
+    if (!on && !pf->on) return;
+#ifdef __linux__
+    ioctl(pf->fds[0], on? PERF_EVENT_IOC_ENABLE: PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    pf->on = on;
+    if (!on) pf->reps += reps;
+}
+
+// prints the counts per iteration
+void PerfClose(void *ctx)
+{
+    Session *ss = ctx;
+    struct Perf *pf = &ss->perf;
+    if (pf->count==0) return;
+#ifdef __linux__
+    double perRep[IC_PERF_MAX];
+    bool counted[IC_PERF_MAX] = {0};
+    printf("Counters per iteration:\n");
+    for (usz i = 0; i<pf->count; ++i) {
+        uint64_t v[3]; // value, time enabled, time running
+        if (read(pf->fds[i], v, sizeof(v))!=sizeof(v) || v[2]==0 || pf->reps==0) {
+            printf("  %-22s not counted\n", perfEventNames[pf->events[i]]);
+            continue;
+        }
+        // multiplexed with other users of the pmu
+        double scale = (double)v[1]/v[2];
+        perRep[pf->events[i]] = v[0]*scale/pf->reps;
+        counted[pf->events[i]] = true;
+        pf->perRep[pf->events[i]] = perRep[pf->events[i]];
+        pf->counted |= 1u<<pf->events[i];
+        printf("  %-22s %12.4g", perfEventNames[pf->events[i]], perRep[pf->events[i]]);
+        if (v[1]!=v[2]) printf("  (counted %.0f%% of the time)", 100.0*v[2]/v[1]);
+        printf("\n");
+    }
+    if (counted[0] && counted[1] && perRep[0]>0) {
+        printf("  %-22s %12.4g\n", "IPC", perRep[1]/perRep[0]);
+    }
+    fflush(stdout);
+#endif
+    PerfCloseFds(pf);
+    if (ss->bench.storePending) {
+        ss->bench.storePending = false;
+        BenchStore(ss);
+        ss->bench.bytes = ss->bench.items = 0;
+    }
+}
+
+// ;t@1,2,4: a pool of pinned threads that run the statement together
+
+struct ThreadPool {
+    usz count; // started threads
+    usz active; // threads taking part in the current round
+    uint64_t round;
+    usz finished;
+    void (*body)(uint64_t reps, int thread);
+    uint64_t reps;
+    uint64_t ns[IC_THREADS_MAX]; // of each thread in the round
+#ifdef _WIN32
+    SRWLOCK lock;
+    CONDITION_VARIABLE start, done;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t start, done;
+#endif
+} pool = {
+#ifdef _WIN32
+    .lock = SRWLOCK_INIT,
+    .start = CONDITION_VARIABLE_INIT,
+    .done = CONDITION_VARIABLE_INIT,
+#else
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+#endif
+};
+
+#ifdef _WIN32
+#define PoolLock() AcquireSRWLockExclusive(&pool.lock)
+#define PoolUnlock() ReleaseSRWLockExclusive(&pool.lock)
+#define PoolWait(COND) SleepConditionVariableSRW(&pool.COND, &pool.lock, INFINITE, 0)
+#define PoolWakeAll(COND) WakeAllConditionVariable(&pool.COND)
+#else
+#define PoolLock() pthread_mutex_lock(&pool.lock)
+#define PoolUnlock() pthread_mutex_unlock(&pool.lock)
+#define PoolWait(COND) pthread_cond_wait(&pool.COND, &pool.lock)
+#define PoolWakeAll(COND) pthread_cond_broadcast(&pool.COND)
+#endif
+
+#ifdef _WIN32
+DWORD WINAPI PoolWorker(LPVOID arg)
+#else
+void *PoolWorker(void *arg)
+#endif
+{
+    int id = (int)(intptr_t)arg;
+    uint64_t seen = 0;
+    for (;;) {
+        PoolLock();
+        while (pool.round==seen || (usz)id>=pool.active) {
+            seen = pool.round;
+            PoolWait(start);
+        }
+        seen = pool.round;
+        void (*body)(uint64_t, int) = pool.body;
+        uint64_t reps = pool.reps;
+        PoolUnlock();
+
+        uint64_t begin = nob_nanos_since_unspecified_epoch();
+        body(reps, id);
+        uint64_t ns = nob_nanos_since_unspecified_epoch()-begin;
+
+        PoolLock();
+        pool.ns[id] = ns;
+        pool.finished += 1;
+        if (pool.finished==pool.active) PoolWakeAll(done);
+        PoolUnlock();
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+usz CpuCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n>0? (usz)n: 1;
+#endif
+}
+
+// the cpus the process may run on, at most max of them; the mask from
+// before ;quiet pinned this thread if it did; 0 where unknown
+usz AllowedCpus(Session *ss, int *cpus, usz max)
+{
+    usz n = 0;
+#ifdef _WIN32
+    DWORD_PTR mask, system;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &system)) return 0;
+    for (int c = 0; c<(int)(8*sizeof(mask)) && n<max; ++c) {
+        if (mask & (DWORD_PTR)1<<c) cpus[n++] = c;
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+    if (ss->quiet.on && ss->quiet.pinned) set = ss->quiet.oldMask;
+    else if (sched_getaffinity(0, sizeof(set), &set)!=0) return 0;
+    for (int c = 0; c<CPU_SETSIZE && n<max; ++c) {
+        if (CPU_ISSET(c, &set)) cpus[n++] = c;
+    }
+#else
+    (void)ss; (void)cpus; (void)max;
+#endif
+    return n;
+}
+
+// thread i runs on cpus[i%cpuCount] where that is possible, the threads
+// stay where they were first put
+bool PoolGrow(usz count, int const *cpus, usz cpuCount)
+{
+    while (pool.count<count) {
+        usz id = pool.count;
+#ifdef _WIN32
+        HANDLE h = CreateThread(NULL, 0, PoolWorker, (LPVOID)(intptr_t)id, 0, NULL);
+        if (h==NULL) return false;
+        if (cpuCount>0) SetThreadAffinityMask(h, (DWORD_PTR)1<<cpus[id%cpuCount]);
+        CloseHandle(h);
+#else
+        pthread_t t;
+        if (pthread_create(&t, NULL, PoolWorker, (void *)(intptr_t)id)!=0) return false;
+    #ifdef __linux__
+        if (cpuCount>0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[id%cpuCount], &set);
+            pthread_setaffinity_np(t, sizeof(set), &set);
+        }
+    #else
+        (void)cpus; (void)cpuCount;
+    #endif
+        pthread_detach(t);
+#endif
+        pool.count += 1;
+    }
+    return true;
+}
+
+// wall time of count threads running reps iterations each, their own times in pool.ns
+uint64_t PoolRun(usz count, void (*body)(uint64_t, int), uint64_t reps)
+{
+    PoolLock();
+    pool.body = body;
+    pool.reps = reps;
+    pool.active = count;
+    pool.finished = 0;
+    pool.round += 1;
+    uint64_t begin = nob_nanos_since_unspecified_epoch();
+    PoolWakeAll(start);
+    while (pool.finished<count) PoolWait(done);
+    uint64_t ns = nob_nanos_since_unspecified_epoch()-begin;
+    pool.active = 0;
+    PoolUnlock();
+    return ns;
+}
+
+// called by a unit before timing with --bytes/--items
+void BenchUnits(void *ctx, double bytes, double items)
+{
+    Session *ss = ctx;
+    ss->bench.bytes = bytes;
+    ss->bench.items = items;
+}
+
+// rounds of count threads until the samples or the max time of to, with the
+// sorted wall times and iteration latencies of every thread; returns the rounds
+usz PoolRounds(usz count, void (*body)(uint64_t, int), uint64_t reps, struct TimeOptions *to,
+    double *wall, double *latency)
+{
+    uint64_t deadline = nob_nanos_since_unspecified_epoch()+(uint64_t)to->maxTimeNs;
+    usz r = 0;
+    for (; r<to->samples; ++r) {
+        wall[r] = (double)PoolRun(count, body, reps);
+        for (usz t = 0; t<count; ++t) latency[r*count+t] = (double)pool.ns[t]/reps;
+        if (r>=2 && nob_nanos_since_unspecified_epoch()>deadline) {
+            r += 1;
+            break;
+        }
+    }
+    qsort(wall, r, sizeof(*wall), DoubleCmp);
+    qsort(latency, r*count, sizeof(*latency), DoubleCmp);
+    return r;
+}
+
+// called by a ;t@ unit, runs body on each count of threads
+void ThreadScaling(void *ctx, char const *options, void (*body)(uint64_t reps, int thread))
+{
+    Session *ss = ctx;
+    double bytes = ss->bench.bytes, items = ss->bench.items;
+    ss->bench.bytes = ss->bench.items = 0;
+    struct TimeOptions to;
+    if (!ParseTimeOptions(nob_sv_from_cstr(options), &to, NULL)) return;
+    usz most = 0;
+    for (usz i = 0; i<to.threadsCount; ++i) if ((usz)to.threads[i]>most) most = to.threads[i];
+    int cpus[IC_THREADS_MAX];
+    usz cpuCount = AllowedCpus(ss, cpus, IC_THREADS_MAX);
+    if (!PoolGrow(most, cpus, cpuCount)) {
+        printf("Could not start %zu threads\n", most);
+        return;
+    }
+    size_t mark = nob_temp_save();
+
+    // warmup and calibration on one thread, like BenchNext reps stop at the
+    // cap and the time is bounded, an empty body never takes minTimeNs
+    struct Bench cal = { .opts = to };
+    uint64_t reps = 1, begin = nob_nanos_since_unspecified_epoch();
+    for (;;) {
+        uint64_t ns = PoolRun(1, body, reps);
+        uint64_t next = BenchScale(&cal, reps, (double)ns);
+        double elapsed = (double)(nob_nanos_since_unspecified_epoch()-begin);
+        if (elapsed>=to.warmupNs && next==reps) break;
+        if (elapsed>=to.warmupNs+to.maxTimeNs) {
+            printf("  warning: calibration stopped at %"PRIu64" reps after --max-time\n", reps);
+            break;
+        }
+        reps = next;
+    }
+
+    usz rounds = to.samples;
+    double *wallN = nob_temp_alloc(rounds*sizeof(double));
+    double *latencyN = nob_temp_alloc(rounds*most*sizeof(double));
+    // sampled first, the baseline of the efficiency and the row of 1 thread
+    double *wall1 = nob_temp_alloc(rounds*sizeof(double));
+    double *latency1 = nob_temp_alloc(rounds*sizeof(double));
+    usz rounds1 = PoolRounds(1, body, reps, &to, wall1, latency1);
+    double base = reps*1e9/QuantileOf(wall1, rounds1, 0.5); // throughput of one thread
+    printf("%zu rounds of %"PRIu64" reps per thread on %zu cpus\n", rounds, reps, cpuCount>0? cpuCount: CpuCount());
+    if (ss->quiet.on) printf("  conditions: %s\n", ss->quiet.conditions);
+    printf("  %7s %12s %14s %14s %11s%s\n", "threads", "throughput", "latency p50", "latency p90", "efficiency",
+        bytes>0 || items>0? "  data": "");
+    for (usz i = 0; i<to.threadsCount; ++i) {
+        usz n = (usz)to.threads[i];
+        double *wall = wall1, *latency = latency1;
+        usz r = rounds1;
+        if (n!=1) {
+            wall = wallN;
+            latency = latencyN;
+            r = PoolRounds(n, body, reps, &to, wall, latency);
+        }
+        double throughput = n*reps*1e9/QuantileOf(wall, r, 0.5);
+        printf("  %7zu %12s %14s %14s %10.0f%%", n, FormatRate(throughput, ""),
+            FormatNs(QuantileOf(latency, r*n, 0.5)), FormatNs(PercentileOf(latency, r*n, 0.9)),
+            base>0? 100*throughput/(n*base): 0);
+        // an iteration of the group takes wall/(n*reps)
+        double groupNs = QuantileOf(wall, r, 0.5)/(n*reps);
+        if (bytes>0 || items>0) printf("  %s", FormatThroughput(bytes, items, groupNs));
+        printf("\n");
+        if (QuantileOf(latency, r*n, 0.5)<CycleNs()) BenchWarnCycle("");
+        FILE *f = TraceFile();
+        if (f!=NULL && !traceChrome) {
+            fprintf(f, "{\"threads\":%zu,\"reps\":%"PRIu64",\"rounds\":%zu,\"per_s\":%.17g,"
+                "\"latency_p50_ns\":%.17g,\"latency_p90_ns\":%.17g,\"efficiency\":%.17g,"
+                "\"bytes_per_s\":%.17g,\"items_per_s\":%.17g,\"conditions\":\"%s\"}\n",
+                n, reps, r, throughput, QuantileOf(latency, r*n, 0.5), PercentileOf(latency, r*n, 0.9),
+                base>0? throughput/(n*base): 0, bytes*1e9/groupNs, items*1e9/groupNs, ss->quiet.conditions);
+            fflush(f);
+        }
+        fflush(stdout);
+    }
+    nob_temp_rewind(mark);
+}
+
+// the model of the time of ;sweep
+struct Complexity {
+    char const *name;
+    double (*f)(double n);
+};
+
+double ComplexityOne(double n) { (void)n; return 1; }
+double ComplexityLog(double n) { return log2(n>2? n: 2); }
+double ComplexityN(double n) { return n; }
+double ComplexityNLog(double n) { return n*log2(n>2? n: 2); }
+double ComplexityN2(double n) { return n*n; }
+double ComplexityN3(double n) { return n*n*n; }
+
+struct Complexity complexities[] = {
+    {"O(1)", ComplexityOne}, {"O(log N)", ComplexityLog}, {"O(N)", ComplexityN},
+    {"O(N log N)", ComplexityNLog}, {"O(N^2)", ComplexityN2}, {"O(N^3)", ComplexityN3},
+};
+
+// the model fitting time = c*f(N) best in log space, NULL with fewer than 3 points
+struct Complexity *FitComplexity(struct SweepPoint *p, usz n, double *exponent)
+{
+    struct Complexity *best = NULL;
+    double bestErr = INFINITY;
+    usz m = 0;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (usz i = 0; i<n; ++i) {
+        if (p[i].n<=0 || p[i].median<=0) continue;
+        double x = log(p[i].n), y = log(p[i].median);
+        sx += x; sy += y; sxx += x*x; sxy += x*y;
+        m += 1;
+    }
+    if (m<3 || m*sxx-sx*sx<=0) return NULL;
+    *exponent = (m*sxy-sx*sy)/(m*sxx-sx*sx);
+    for (usz k = 0; k<NOB_ARRAY_LEN(complexities); ++k) {
+        double c = 0, err = 0;
+        for (usz i = 0; i<n; ++i) {
+            if (p[i].n>0 && p[i].median>0) c += log(p[i].median/complexities[k].f(p[i].n));
+        }
+        c /= m;
+        for (usz i = 0; i<n; ++i) {
+            if (p[i].n<=0 || p[i].median<=0) continue;
+            double r = log(p[i].median/complexities[k].f(p[i].n))-c;
+            err += r*r;
+        }
+        if (err<bestErr) {
+            bestErr = err;
+            best = &complexities[k];
+        }
+    }
+    return best;
+}
+
+void SweepReport(Session *ss)
+{
+    struct Sweep *sw = &ss->sweep;
+    struct SweepPoint *p = sw->points.items;
+    usz n = sw->points.count;
+    if (n==0) return;
+    size_t mark = nob_temp_save();
+    bool units = false;
+    double most = 0;
+    for (usz i = 0; i<n; ++i) {
+        units = units || p[i].bytes>0 || p[i].items>0;
+        double per = p[i].n>0? p[i].median/p[i].n: p[i].median;
+        if (per>most) most = per;
+    }
+    printf("sweep of %s over %zu values\n", sw->name, n);
+    char const *per = nob_temp_sprintf("per %s", sw->name);
+    printf("  %12s %10s %21s %10s%s  time %s\n", sw->name, "median", "mean +- 95% ci", per,
+        units? "   throughput": "", per);
+    for (usz i = 0; i<n; ++i) {
+        double per = p[i].n>0? p[i].median/p[i].n: p[i].median;
+        printf("  %12.6g %10s %10s +- %-8s %10s", p[i].n, FormatNs(p[i].median),
+            FormatNs(p[i].mean), FormatNs(p[i].ci), FormatNs(per));
+        if (units) printf("  %11s", FormatThroughput(p[i].bytes, p[i].items, p[i].median));
+        // a bar of the cost per N, cache cliffs are steps
+        int bar = most>0? (int)(40*per/most+0.5): 0;
+        printf("  |");
+        for (int j = 0; j<bar; ++j) putchar('#');
+        printf("\n");
+    }
+    double exponent = 0;
+    struct Complexity *fit = FitComplexity(p, n, &exponent);
+    if (fit!=NULL) {
+        printf("  fits %s best, time grows as %s^%.2f\n", fit->name, sw->name, exponent);
+        // steps against the model, e.g. the working set leaving a cache level
+        for (usz i = 1; i<n; ++i) {
+            if (p[i-1].median<=0 || p[i-1].n<=0 || p[i].n<=0) continue;
+            double step = (p[i].median/p[i-1].median)/(fit->f(p[i].n)/fit->f(p[i-1].n));
+            if (step>=1.5) {
+                printf("  %.2gx slower than %s between %s=%.6g and %.6g\n", step, fit->name, sw->name, p[i-1].n, p[i].n);
+            }
+        }
+    }
+    for (usz i = 0; i<n; ++i) {
+        if (p[i].median<CycleNs()) {
+            BenchWarnCycle(nob_temp_sprintf("%s=%.6g", sw->name, p[i].n));
+            break;
+        }
+    }
+    if (ss->quiet.on) printf("  conditions: %s\n", ss->quiet.conditions);
+
+    if (sw->csv[0]!='\0') {
+        StrBuilder csv = {0};
+        nob_sb_appendf(&csv, "%s,reps,min_ns,median_ns,mean_ns,ci95_ns,bytes_per_s,items_per_s\n", sw->name);
+        for (usz i = 0; i<n; ++i) {
+            nob_sb_appendf(&csv, "%.17g,%"PRIu64",%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n", p[i].n, p[i].reps,
+                p[i].min, p[i].median, p[i].mean, p[i].ci,
+                p[i].median>0? p[i].bytes*1e9/p[i].median: 0, p[i].median>0? p[i].items*1e9/p[i].median: 0);
+        }
+        if (nob_write_entire_file(sw->csv, csv.items, csv.count)) printf("  wrote %s\n", sw->csv);
+        nob_sb_free(csv);
+    }
+    FILE *f = TraceFile();
+    if (f!=NULL && !traceChrome) {
+        for (usz i = 0; i<n; ++i) {
+            fprintf(f, "{\"sweep\":\"%s\",\"n\":%.17g,\"reps\":%"PRIu64",\"min_ns\":%.17g,\"median_ns\":%.17g,"
+                "\"mean_ns\":%.17g,\"ci95_ns\":%.17g,\"bytes_per_s\":%.17g,\"items_per_s\":%.17g,\"conditions\":\"%s\"}\n",
+                sw->name, p[i].n, p[i].reps, p[i].min, p[i].median, p[i].mean, p[i].ci,
+                p[i].median>0? p[i].bytes*1e9/p[i].median: 0, p[i].median>0? p[i].items*1e9/p[i].median: 0,
+                ss->quiet.conditions);
+        }
+        fflush(f);
+    }
+    fflush(stdout);
+    nob_temp_rewind(mark);
+}
+
+// called by a ;sweep unit before the harness of each value and with n<0 after the last
+void SweepPoint(void *ctx, double n)
+{
+    Session *ss = ctx;
+    struct Sweep *sw = &ss->sweep;
+    struct Bench *b = &ss->bench;
+    struct BenchVariant *v = &b->variants[0];
+    if (sw->active && b->count>0 && v->samples.count>0) {
+        struct SampleStats st;
+        SampleStatsOf(v->samples.items, v->samples.count, &st);
+        struct SweepPoint point = {
+            .n = sw->n, .reps = v->reps,
+            .min = st.min, .median = st.median, .mean = st.mean, .ci = st.ci,
+            .bytes = b->bytes, .items = b->items,
+        };
+        nob_da_append(&sw->points, point);
+        v->samples.count = 0;
+    }
+    if (n>=0) {
+        if (!sw->active) sw->points.count = 0;
+        sw->active = true;
+        sw->n = n;
+        b->hold = true;
+        b->bytes = b->items = 0;
+        return;
+    }
+    sw->active = false;
+    b->hold = false;
+    SweepReport(ss);
+    b->bytes = b->items = 0;
+}
+
+// the clock of cpu: scaling governor and turbo as far as sysfs tells
+void FrequencyConditions(int cpu, StrBuilder *conditions, StrBuilder *warnings)
+{
+#ifdef __linux__
+    size_t mark = nob_temp_save();
+    char const *governor = ReadFirstLine(nob_temp_sprintf("/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu));
+    if (governor[0]!='\0') {
+        nob_sb_appendf(conditions, ", governor %s", governor);
+        if (strcmp(governor, "performance")!=0 && warnings!=NULL) {
+            nob_sb_appendf(warnings, "the scaling governor of cpu %d is %s, not performance\n", cpu, governor);
+        }
+    }
+    // intel_pstate has no_turbo, acpi-cpufreq and amd-pstate boost
+    char const *noTurbo = ReadFirstLine("/sys/devices/system/cpu/intel_pstate/no_turbo");
+    char const *boost = ReadFirstLine("/sys/devices/system/cpu/cpufreq/boost");
+    int turbo = noTurbo[0]!='\0'? noTurbo[0]=='0': boost[0]!='\0'? boost[0]=='1': -1;
+    if (turbo>=0) nob_sb_appendf(conditions, ", turbo %s", turbo? "on": "off");
+    if (turbo==1 && warnings!=NULL) {
+        nob_sb_appendf(warnings, "turbo is on, the clock follows temperature and load\n");
+    }
+    nob_temp_rewind(mark);
+#else
+    (void)cpu; (void)conditions; (void)warnings;
+#endif
+}
+
+// faults in the stack below the caller before anything is timed
+void PreTouchStack(void)
+{
+    volatile char pages[256*1024];
+    for (usz i = 0; i<sizeof(pages); i += 4096) pages[i] = 0;
+}
+
+// pins the thread, raises its priority and locks the memory as far as
+// permitted, conditions tells what was applied
+void QuietEnter(Session *ss, StrBuilder *warnings)
+{
+    struct Quiet *q = &ss->quiet;
+    StrBuilder sb = {0};
+#ifdef _WIN32
+    q->oldMask = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1<<(q->cpu%(8*sizeof(DWORD_PTR))));
+    q->pinned = q->oldMask!=0;
+    q->oldPriority = GetThreadPriority(GetCurrentThread());
+    bool raised = q->priority && SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+#else
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(q->cpu, &set);
+    q->pinned = sched_getaffinity(0, sizeof(q->oldMask), &q->oldMask)==0 && sched_setaffinity(0, sizeof(set), &set)==0;
+#else
+    q->pinned = false;
+#endif
+    errno = 0;
+    q->oldPriority = getpriority(PRIO_PROCESS, 0);
+    bool raised = q->priority && errno==0 && setpriority(PRIO_PROCESS, 0, -10)==0;
+#endif
+    PreTouchStack();
+    if (q->pinned) nob_sb_appendf(&sb, "cpu %d", q->cpu);
+    else nob_sb_append_cstr(&sb, "not pinned");
+    if (raised) nob_sb_append_cstr(&sb, ", priority raised");
+    else if (q->priority) nob_sb_append_cstr(&sb, ", priority not raised");
+#ifndef _WIN32
+    nob_sb_append_cstr(&sb, q->locked? ", memory locked": ", memory not locked");
+#endif
+    FrequencyConditions(q->cpu, &sb, warnings);
+    if (warnings!=NULL) {
+        if (!q->pinned) nob_sb_appendf(warnings, "could not pin to cpu %d\n", q->cpu);
+        if (q->priority && !raised) nob_sb_appendf(warnings, "could not raise the priority, it takes privileges\n");
+    }
+    snprintf(q->conditions, sizeof(q->conditions), "%.*s", (int)sb.count, sb.items);
+    nob_sb_free(sb);
+}
+
+void QuietLeave(Session *ss)
+{
+    struct Quiet *q = &ss->quiet;
+#ifdef _WIN32
+    if (q->pinned) SetThreadAffinityMask(GetCurrentThread(), q->oldMask);
+    SetThreadPriority(GetCurrentThread(), q->oldPriority);
+#else
+#ifdef __linux__
+    if (q->pinned) sched_setaffinity(0, sizeof(q->oldMask), &q->oldMask);
+#endif
+    if (q->priority) setpriority(PRIO_PROCESS, 0, q->oldPriority);
+#endif
+}
+
+// ;quiet [cpu] [--priority] | off
+void SetQuiet(Session *ss, Nob_String_View args)
+{
+    struct Quiet *q = &ss->quiet;
+    if (nob_sv_eq(args, nob_sv_from_cstr("off"))) {
+#ifndef _WIN32
+        if (q->locked) munlockall();
+        q->locked = false;
+#endif
+        q->on = false;
+        q->conditions[0] = '\0';
+        printf("quiet benchmark mode: off\n");
+        return;
+    }
+    size_t mark = nob_temp_save();
+    int cpu = (int)CpuCount()-1;
+    bool priority = false;
+    while (args.count>0) {
+        Nob_String_View word = nob_sv_chop_by_delim(&args, ' ');
+        args = nob_sv_trim_left(args);
+        if (word.count==0) continue;
+        if (nob_sv_eq(word, nob_sv_from_cstr("--priority"))) {
+            priority = true;
+        } else if (isdigit((unsigned char)word.data[0])) {
+            cpu = atoi(nob_temp_sv_to_cstr(word));
+        } else {
+            printf("Usage: "CMD_SIGN"quiet [cpu] [--priority] | off\n");
+            goto end;
+        }
+    }
+    q->on = true;
+    q->cpu = cpu;
+    q->priority = priority;
+#ifndef _WIN32
+    // once, not per evaluation: mlockall walks every mapping
+    if (!q->locked) q->locked = mlockall(MCL_CURRENT)==0;
+#endif
+    StrBuilder warnings = {0};
+    QuietEnter(ss, &warnings);
+    QuietLeave(ss);
+    printf("quiet benchmark mode: %s\n", q->conditions);
+    Nob_String_View sv = nob_sv_from_parts(warnings.items, warnings.count);
+    while (sv.count>0) {
+        Nob_String_View line = nob_sv_chop_by_delim(&sv, '\n');
+        printf("warning: "SV_Fmt"\n", SV_Arg(line));
+    }
+    nob_sb_free(warnings);
+end:
+    nob_temp_rewind(mark);
+}
+
+// ;fixtures [clear]
+void Fixtures(Session *ss, Nob_String_View args)
+{
+    if (nob_sv_eq(args, nob_sv_from_cstr("clear"))) {
+        FixturesClear(ss);
+        printf("cleared fixtures\n");
+        return;
+    } else if (args.count>0) {
+        printf("Usage: "CMD_SIGN"fixtures [clear]\n");
+        return;
+    }
+    if (ss->fixtures.count==0) printf("no fixtures\n");
+    static char const *const kinds[] = {
+        [FIXTURE_U32] = "u32", [FIXTURE_U64] = "u64", [FIXTURE_F64] = "f64", [FIXTURE_FILE] = "file",
+    };
+    size_t mark = nob_temp_save();
+    for (usz i = 0; i<ss->fixtures.count; ++i) {
+        struct Fixture *f = &ss->fixtures.items[i];
+        if (f->data==NULL) continue;
+        printf("%-16s %-4s %10s  ", f->name, kinds[f->kind], FormatBytes((double)f->size));
+        if (f->kind==FIXTURE_FILE) printf("%s%s\n", f->path, f->mapped? " (mapped)": "");
+        else printf("n=%"PRIu64" seed=%"PRIu64"\n", f->n, f->seed);
+    }
+    nob_temp_rewind(mark);
+}
+
+// ;prof: SIGPROF every 1/hz of cpu time, the handler keeps the pc and the
+// return addresses of the frame pointer chain, symbols come afterwards
+#if !defined(_WIN32) && (defined(__linux__) || defined(__APPLE__)) \
+    && (defined(__x86_64__) || defined(__aarch64__))
+#define IC_SAMPLER
+#endif
+
+#ifdef IC_SAMPLER
+#define IC_PROF_DEPTH 32
+#define IC_PROF_MAX 20000
+#define IC_PROF_HZ 1000
+
+struct ProfSample {
+    int depth;
+    void *pc[IC_PROF_DEPTH]; // innermost first, return addresses minus one
+    void *leafRet; // [sp] or lr, the caller of a leaf without a frame
+};
+
+struct ProfSample *profSamples = NULL;
+usz profCount = 0;
+uintptr_t profStackLo = 0, profStackHi = 0;
+struct sigaction profOldAction;
+
+void ProfHandler(int sig, siginfo_t *info, void *context)
+{
+    (void)sig;
+    (void)info;
+    usz i = __atomic_fetch_add(&profCount, 1, __ATOMIC_RELAXED);
+    if (profSamples==NULL || i>=IC_PROF_MAX) return;
+    ucontext_t *uc = context;
+    uintptr_t pc, fp, leafRet;
+#if defined(__linux__) && defined(__x86_64__)
+    pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+    uintptr_t sp = (uintptr_t)uc->uc_mcontext.gregs[REG_RSP];
+    leafRet = sp>=profStackLo && sp+sizeof(void *)<=profStackHi? *(uintptr_t *)sp: 0;
+#elif defined(__linux__)
+    pc = (uintptr_t)uc->uc_mcontext.pc;
+    fp = (uintptr_t)uc->uc_mcontext.regs[29];
+    leafRet = (uintptr_t)uc->uc_mcontext.regs[30];
+#elif defined(__x86_64__)
+    pc = (uintptr_t)uc->uc_mcontext->__ss.__rip;
+    fp = (uintptr_t)uc->uc_mcontext->__ss.__rbp;
+    uintptr_t sp = (uintptr_t)uc->uc_mcontext->__ss.__rsp;
+    leafRet = sp>=profStackLo && sp+sizeof(void *)<=profStackHi? *(uintptr_t *)sp: 0;
+#else
+    pc = (uintptr_t)uc->uc_mcontext->__ss.__pc;
+    fp = (uintptr_t)uc->uc_mcontext->__ss.__fp;
+    leafRet = (uintptr_t)uc->uc_mcontext->__ss.__lr;
+#endif
+    struct ProfSample *s = &profSamples[i];
+    s->depth = 0;
+    s->pc[s->depth++] = (void *)pc;
+    // a saved stack address is no return address
+    s->leafRet = leafRet>=profStackLo && leafRet<profStackHi? NULL: (void *)(leafRet-1);
+    // [fp] is the caller's fp and [fp+1] the return address, only
+    // within the stack of the sampled thread and only upwards
+    while (s->depth<IC_PROF_DEPTH && fp%sizeof(void *)==0
+        && fp>=profStackLo && fp+2*sizeof(void *)<=profStackHi) {
+        uintptr_t *frame = (uintptr_t *)fp;
+        if (frame[1]==0) break;
+        s->pc[s->depth++] = (void *)(frame[1]-1);
+        if (frame[0]<=fp) break;
+        fp = frame[0];
+    }
+}
+
+double ProcessCpuNs(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return 1e9*t.tv_sec + t.tv_nsec;
+}
+
+void SamplerStart(struct Sampler *sp)
+{
+    if (profSamples==NULL) profSamples = malloc(IC_PROF_MAX*sizeof(*profSamples));
+    if (profSamples==NULL) return;
+    __atomic_store_n(&profCount, 0, __ATOMIC_RELAXED);
+#ifdef __APPLE__
+    profStackHi = (uintptr_t)pthread_get_stackaddr_np(pthread_self());
+    profStackLo = profStackHi - pthread_get_stacksize_np(pthread_self());
+#else
+    pthread_attr_t attr;
+    void *addr;
+    size_t size;
+    if (pthread_getattr_np(pthread_self(), &attr)==0) {
+        pthread_attr_getstack(&attr, &addr, &size);
+        profStackLo = (uintptr_t)addr;
+        profStackHi = (uintptr_t)addr + size;
+        pthread_attr_destroy(&attr);
+    }
+#endif
+    struct sigaction sa = {0};
+    sa.sa_sigaction = ProfHandler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, &profOldAction);
+    long us = 1000000/sp->hz;
+    struct itimerval it = { {us/1000000, us%1000000}, {us/1000000, us%1000000} };
+    setitimer(ITIMER_PROF, &it, NULL);
+    sp->startNs = nob_nanos_since_unspecified_epoch();
+    sp->cpuStartNs = ProcessCpuNs();
+    sp->runs = 0;
+    sp->active = true;
+}
+
+void SamplerStop(struct Sampler *sp)
+{
+    struct itimerval it = {0};
+    setitimer(ITIMER_PROF, &it, NULL);
+    // a tick raised before the timer stopped is taken here, under the old
+    // disposition SIG_DFL it would end the process
+    sigset_t prof, mask, pending;
+    sigemptyset(&prof);
+    sigaddset(&prof, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &prof, &mask);
+    if (sigpending(&pending)==0 && sigismember(&pending, SIGPROF)) {
+        int sig;
+        sigwait(&prof, &sig);
+    }
+    sigaction(SIGPROF, &profOldAction, NULL);
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
+    sp->active = false;
+}
+
+// a function of the samples, session ones are defined at line
+struct ProfFunc {
+    char const *name;   // NULL if unknown
+    char const *object; // file name of the shared object, NULL for the session
+    usz line;
+    uint64_t self, total;
+    usz lastSample;
+};
+
+struct ProfFuncs {
+    struct ProfFunc *items;
+    usz count;
+    usz capacity;
+};
+
+struct ProfSym {
+    uintptr_t addr;
+    char const *name;
+};
+
+struct ProfSyms {
+    struct ProfSym *items;
+    usz count;
+    usz capacity;
+};
+
+struct ProfLineHits {
+    usz line;
+    uint64_t samples;
+};
+
+// a sample as indices into the functions, up to ic_main
+struct ProfStack {
+    int depth;
+    int f[IC_PROF_DEPTH+1];
+};
+
+int ProfSymCmp(void const *a, void const *b)
+{
+    struct ProfSym const *x = a, *y = b;
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+int PtrCmp(void const *a, void const *b)
+{
+    uintptr_t x = *(uintptr_t const *)a, y = *(uintptr_t const *)b;
+    return (x > y) - (x < y);
+}
+
+int ProfFuncSelfCmp(void const *a, void const *b)
+{
+    struct ProfFunc const *x = a, *y = b;
+    return (x->self < y->self) - (x->self > y->self);
+}
+
+int ProfLineHitsCmp(void const *a, void const *b)
+{
+    struct ProfLineHits const *x = a, *y = b;
+    return (x->samples < y->samples) - (x->samples > y->samples);
+}
+
+// root first, so that equal stacks end up next to each other
+int ProfStackCmp(void const *a, void const *b)
+{
+    struct ProfStack const *x = a, *y = b;
+    for (int i = 1; i<=x->depth && i<=y->depth; ++i) {
+        int d = x->f[x->depth-i] - y->f[y->depth-i];
+        if (d!=0) return d;
+    }
+    return x->depth - y->depth;
+}
+
+void ProfListSymbol(void *ctx, char const *name, void const *val)
+{
+    Dl_info info;
+    // resolved from a shared object, not code of the unit
+    if (dladdr(val, &info)!=0) return;
+    struct ProfSym sym = { (uintptr_t)val, name };
+    nob_da_append((struct ProfSyms *)ctx, sym);
+}
+
+// the line of pre where function name is defined, 0 if not found
+usz FunctionLine(StrBuilder *pre, char const *name)
+{
+    Nob_String_View sv = nob_sv_from_parts(pre->items, pre->count);
+    usz n = strlen(name), line = 0;
+    while (sv.count>0) {
+        Nob_String_View l = nob_sv_chop_by_delim(&sv, '\n');
+        if (IsCppOf(l, "line")) {
+            char const *p = l.data;
+            while (p<l.data+l.count && !isdigit((unsigned char)*p)) ++p;
+            line = (usz)strtoull(p, NULL, 10);
+            continue;
+        }
+        Nob_String_View t = nob_sv_trim(l);
+        // name( but not a prototype
+        for (usz i = 0; t.count>0 && t.data[t.count-1]!=';' && i+n<=l.count; ++i) {
+            if (memcmp(l.data+i, name, n)!=0) continue;
+            if (i>0 && (isalnum((unsigned char)l.data[i-1]) || l.data[i-1]=='_')) continue;
+            usz j = i+n;
+            while (j<l.count && isspace((unsigned char)l.data[j])) ++j;
+            if (j<l.count && l.data[j]=='(') return line;
+        }
+        line += 1;
+    }
+    return 0;
+}
+
+// the code at line in the parts of the session, the last one where
+// generated code shares the line
+Nob_String_View SourceLine(StrBuilder **parts, usz count, usz line)
+{
+    Nob_String_View found = nob_sv_from_cstr("");
+    for (usz k = 0; k<count; ++k) {
+        Nob_String_View sv = nob_sv_from_parts(parts[k]->items, parts[k]->count);
+        usz at = 0;
+        while (sv.count>0) {
+            Nob_String_View l = nob_sv_chop_by_delim(&sv, '\n');
+            if (IsCppOf(l, "line")) {
+                char const *p = l.data;
+                while (p<l.data+l.count && !isdigit((unsigned char)*p)) ++p;
+                at = (usz)strtoull(p, NULL, 10);
+                continue;
+            }
+            if (at!=0 && at==line) found = nob_sv_trim(l);
+            if (at!=0) at += 1;
+        }
+    }
+    return found;
+}
+
+int ProfFuncOf(struct ProfFuncs *funcs, char const *name, char const *object)
+{
+    for (usz i = 0; i<funcs->count; ++i) {
+        struct ProfFunc *f = &funcs->items[i];
+        bool sameName = f->name==name || (f->name!=NULL && name!=NULL && strcmp(f->name, name)==0);
+        bool sameObject = f->object==object || (f->object!=NULL && object!=NULL && strcmp(f->object, object)==0);
+        if (sameName && sameObject) return (int)i;
+    }
+    struct ProfFunc f = { .name = name, .object = object };
+    nob_da_append(funcs, f);
+    return (int)funcs->count-1;
+}
+
+// --hz=1000 --min-time=0 --folded=path
+bool ParseProfOptions(Nob_String_View args, struct Sampler *sp)
+{
+    bool ok = false;
+    size_t mark = nob_temp_save();
+    sp->hz = IC_PROF_HZ;
+    sp->minNs = 0;
+    sp->folded[0] = '\0';
+    while (args.count>0) {
+        Nob_String_View word = nob_sv_chop_by_delim(&args, ' ');
+        args = nob_sv_trim_left(args);
+        if (word.count==0) continue;
+        if (nob_sv_starts_with(word, nob_sv_from_cstr("--hz="))) {
+            sp->hz = atoi(nob_temp_sv_to_cstr(nob_sv_from_parts(word.data+5, word.count-5)));
+            if (sp->hz>=1 && sp->hz<=10000) continue;
+        } else if (nob_sv_starts_with(word, nob_sv_from_cstr("--min-time="))) {
+            if (ParseDuration(nob_sv_from_parts(word.data+11, word.count-11), &sp->minNs)) continue;
+        } else if (nob_sv_starts_with(word, nob_sv_from_cstr("--folded="))) {
+            snprintf(sp->folded, sizeof(sp->folded), SV_Fmt, (int)word.count-9, word.data+9);
+            continue;
+        }
+        printf("Usage: "CMD_SIGN"prof [--hz=1000] [--min-time=0] [--folded=path], hz up to 10000\n");
+        goto end;
+    }
+    ok = true;
+end:
+    nob_temp_rewind(mark);
+    return ok;
+}
+
+// flat profile, hits per line and the folded stacks of the samples
+void ProfReport(Session *ss)
+{
+    struct Sampler *sp = &ss->sampler;
+    usz n = profCount<IC_PROF_MAX? profCount: IC_PROF_MAX;
+    size_t mark = nob_temp_save();
+    struct ProfSyms syms = {0};
+    struct ProfFuncs funcs = {0};
+    struct { struct ProfLineHits *items; usz count; usz capacity; } lines = {0};
+    struct { uintptr_t *items; usz count; usz capacity; } pcs = {0};
+    int *pcFunc = NULL;
+    struct ProfStack *stacks = NULL;
+    StrBuilder folded = {0};
+
+    double wallNs = (double)(nob_nanos_since_unspecified_epoch() - sp->startNs);
+    double cpuNs = ProcessCpuNs() - sp->cpuStartNs;
+    printf("profile: %zu samples over %s of cpu time, %"PRIu64" run%s in %s\n",
+        n, FormatNs(cpuNs), sp->runs, sp->runs==1? "": "s", FormatNs(wallNs));
+    // cpu timers only fire on the scheduler tick
+    if (cpuNs>0.1e9 && n<0.5*sp->hz*cpuNs/1e9) {
+        printf("the kernel sampled at %.0fHz, not %dHz\n", n/(cpuNs/1e9), sp->hz);
+    }
+    if (profCount>IC_PROF_MAX) printf("dropped %zu samples over %d\n", profCount-IC_PROF_MAX, IC_PROF_MAX);
+    if (n==0) {
+        printf("no samples, it took less than %s of cpu time, --min-time=1s runs it again until then\n",
+            FormatNs(1e9/sp->hz));
+        goto end;
+    }
+
+    // code of the unit: tcc's symbols, or the shared object of ic_main
+    void *icMain = SessionSymbol(ss, "ic_main");
+    void *unitBase = NULL;
+    Dl_info info;
+    if (ss->state!=NULL) {
+        tcc_list_symbols(ss->state, &syms, ProfListSymbol);
+        qsort(syms.items, syms.count, sizeof(*syms.items), ProfSymCmp);
+    } else if (icMain!=NULL && dladdr(icMain, &info)!=0) {
+        unitBase = info.dli_fbase;
+    }
+
+    // every distinct address resolved once
+    for (usz i = 0; i<n; ++i) {
+        struct ProfSample *s = &profSamples[i];
+        for (int k = 0; k<s->depth; ++k) nob_da_append(&pcs, (uintptr_t)s->pc[k]);
+        if (s->leafRet!=NULL) nob_da_append(&pcs, (uintptr_t)s->leafRet);
+    }
+    qsort(pcs.items, pcs.count, sizeof(*pcs.items), PtrCmp);
+    usz unique = 0;
+    for (usz i = 0; i<pcs.count; ++i) {
+        if (unique==0 || pcs.items[unique-1]!=pcs.items[i]) pcs.items[unique++] = pcs.items[i];
+    }
+    pcs.count = unique;
+    pcFunc = malloc(unique*sizeof(*pcFunc));
+    for (usz i = 0; i<unique; ++i) {
+        void *pc = (void *)pcs.items[i];
+        char const *name = NULL, *object = NULL;
+        bool session = false;
+        if (dladdr(pc, &info)!=0) {
+            name = info.dli_sname;
+            session = unitBase!=NULL && info.dli_fbase==unitBase;
+            if (!session && info.dli_fname!=NULL) {
+                char const *slash = strrchr(info.dli_fname, '/');
+                object = slash!=NULL? slash+1: info.dli_fname;
+            }
+        } else if (syms.count>0 && pcs.items[i]>=syms.items[0].addr) {
+            // the last symbol at or below pc
+            usz lo = 0, hi = syms.count;
+            while (hi-lo>1) {
+                usz mid = (lo+hi)/2;
+                if (syms.items[mid].addr<=pcs.items[i]) lo = mid;
+                else hi = mid;
+            }
+            name = syms.items[lo].name;
+            session = true;
+        } else {
+            object = "?";
+        }
+        pcFunc[i] = ProfFuncOf(&funcs, name, session? NULL: object);
+        struct ProfFunc *f = &funcs.items[pcFunc[i]];
+        if (session && f->line==0 && name!=NULL) {
+            f->line = strcmp(name, "ic_main")==0? sp->line: FunctionLine(&ss->pre, name);
+        }
+    }
+
+    stacks = malloc(n*sizeof(*stacks));
+    for (usz i = 0; i<n; ++i) {
+        struct ProfSample *s = &profSamples[i];
+        struct ProfStack *st = &stacks[i];
+        st->depth = 0;
+        for (int k = 0; k<s->depth; ++k) {
+            uintptr_t key = (uintptr_t)s->pc[k];
+            uintptr_t *at = bsearch(&key, pcs.items, pcs.count, sizeof(*pcs.items), PtrCmp);
+            int f = pcFunc[at-pcs.items];
+            st->f[st->depth++] = f;
+            if (k==0 && s->leafRet!=NULL) {
+                // the frame pointer chain skips the caller of a leaf without a frame
+                key = (uintptr_t)s->leafRet;
+                at = bsearch(&key, pcs.items, pcs.count, sizeof(*pcs.items), PtrCmp);
+                int caller = pcFunc[at-pcs.items];
+                int next = -1;
+                if (s->depth>1) {
+                    key = (uintptr_t)s->pc[1];
+                    next = pcFunc[(uintptr_t *)bsearch(&key, pcs.items, pcs.count, sizeof(*pcs.items), PtrCmp)-pcs.items];
+                }
+                if (funcs.items[caller].object==NULL && funcs.items[caller].name!=NULL
+                    && caller!=f && caller!=next) {
+                    st->f[st->depth++] = caller;
+                }
+            }
+            struct ProfFunc *fn = &funcs.items[st->f[st->depth-1]];
+            // frames above ic_main are ic's own
+            if (fn->object==NULL && fn->name!=NULL && strcmp(fn->name, "ic_main")==0) break;
+        }
+        funcs.items[st->f[0]].self += 1;
+        usz line = sp->line;
+        for (int k = st->depth-1; k>=0; --k) {
+            struct ProfFunc *fn = &funcs.items[st->f[k]];
+            if (fn->lastSample!=i+1) fn->total += 1;
+            fn->lastSample = i+1;
+            if (fn->object==NULL && fn->line!=0) line = fn->line;
+        }
+        usz j;
+        for (j = 0; j<lines.count && lines.items[j].line!=line; ++j) {}
+        if (j==lines.count) {
+            struct ProfLineHits h = { .line = line };
+            nob_da_append(&lines, h);
+        }
+        lines.items[j].samples += 1;
+    }
+
+    if (sp->folded[0]!='\0') {
+        qsort(stacks, n, sizeof(*stacks), ProfStackCmp);
+        for (usz i = 0; i<n; ) {
+            usz same = i+1;
+            while (same<n && ProfStackCmp(&stacks[i], &stacks[same])==0) ++same;
+            for (int k = stacks[i].depth-1; k>=0; --k) {
+                struct ProfFunc *fn = &funcs.items[stacks[i].f[k]];
+                if (fn->name!=NULL) nob_sb_append_cstr(&folded, fn->name);
+                else nob_sb_appendf(&folded, "[%s]", fn->object!=NULL? fn->object: "?");
+                if (k>0) nob_da_append(&folded, ';');
+            }
+            nob_sb_appendf(&folded, " %zu\n", same-i);
+            i = same;
+        }
+    }
+
+    // the funcs indices of the stacks are done with
+    qsort(funcs.items, funcs.count, sizeof(*funcs.items), ProfFuncSelfCmp);
+    printf("%7s %6s %6s  %s\n", "self", "self%", "total%", "function");
+    for (usz i = 0; i<funcs.count && i<20; ++i) {
+        struct ProfFunc *fn = &funcs.items[i];
+        if (fn->self==0) break;
+        printf("%7"PRIu64" %5.1f%% %5.1f%%  %-24s ", fn->self, 100.0*fn->self/n, 100.0*fn->total/n,
+            fn->name!=NULL? fn->name: "?");
+        if (fn->object!=NULL) printf("%s\n", fn->object);
+        else if (fn->line!=0) printf("line %zu\n", fn->line);
+        else printf("\n");
+    }
+    StrBuilder *parts[] = { &ss->pre, &ss->src, &ss->last };
+    qsort(lines.items, lines.count, sizeof(*lines.items), ProfLineHitsCmp);
+    printf("%7s %7s %6s  %s\n", "line", "samples", "share", "code");
+    for (usz j = 0; j<lines.count && j<20; ++j) {
+        struct ProfLineHits *h = &lines.items[j];
+        Nob_String_View code = SourceLine(parts, NOB_ARRAY_LEN(parts), h->line);
+        printf("%7zu %7"PRIu64" %5.1f%%  %.*s%s\n", h->line, h->samples, 100.0*h->samples/n,
+            (int)(code.count>40? 40: code.count), code.data, code.count>40? "...": "");
+    }
+    if (n<100) printf("only %zu samples, --min-time=1s runs it again until then\n", n);
+    if (sp->folded[0]!='\0') {
+        if (nob_write_entire_file(sp->folded, folded.items, folded.count)) {
+            printf("folded stacks written to %s, e.g. for flamegraph.pl\n", sp->folded);
+        }
+    }
+
+end:
+    fflush(stdout);
+    free(profSamples);
+    profSamples = NULL;
+    free(pcFunc);
+    free(stacks);
+    nob_da_free(pcs);
+    nob_da_free(syms);
+    nob_da_free(funcs);
+    nob_da_free(lines);
+    nob_sb_free(folded);
+    nob_temp_rewind(mark);
+}
+
+// called by a ;prof unit with its options before the statement and with
+// NULL after each run of it, returns 1 while it should run again
+int ProfToggle(void *ctx, char const *options, int line)
+{
+    Session *ss = ctx;
+    struct Sampler *sp = &ss->sampler;
+    if (options!=NULL) {
+        if (!ParseProfOptions(nob_sv_from_cstr(options), sp)) return 0;
+        sp->line = (usz)line;
+        SamplerStart(sp);
+        return 0;
+    }
+    if (!sp->active) return 0;
+    sp->runs += 1;
+    double ns = (double)(nob_nanos_since_unspecified_epoch() - sp->startNs);
+    if (ns<sp->minNs && profCount<IC_PROF_MAX) return 1;
+    SamplerStop(sp);
+    ProfReport(ss);
+    return 0;
+}
+#endif // IC_SAMPLER
+
+// compiles and runs the session with first and last as the current cell;
+// on success the unit stays loaded until the next successful Run
+int Run(Session *ss, usz line, StrBuilder *first, StrBuilder *last)
+{
+    typedef int (*IcMain)(int, char **);
+    IcMain ic_main = NULL;
+    TCCState *s = NULL;
+    StrBuilder *sbSrc = &ss->sbSrc, *sbOpt = &ss->sbOpt;
+    RunType rt = ss->rt;
+    Nob_Cmd *opt = &ss->opt, *arg = &ss->arg;
+    int r = -1;
+    char const *loadPath = NULL;
+    bool kept = false;
+#ifdef IC_CACHE
+    uint64_t cacheKey = 0;
+#endif
+    // nothing to isolate in a build
+    if (ss->runHook!=NULL && !ss->buildOnly) return ss->runHook(ss, line, first, last);
+    struct EvalStats st = { .rt = rt };
+    enum Phase phase = PH_PREPARE;
+    uint64_t t = nob_nanos_since_unspecified_epoch();
+    // ends the current phase
+#define IC_PHASE(NEXT) do { \
+        uint64_t now_ = nob_nanos_since_unspecified_epoch(); \
+        if (st.ns[phase]==0) st.at[phase] = t; \
+        st.ns[phase] += now_-t; \
+        t = now_; \
+        phase = (NEXT); \
+    } while (0)
+    st.ns[PH_INPUT] = inputNs;
+    st.at[PH_INPUT] = t-inputNs;
+    inputNs = 0;
+    ss->ranMain = false;
+    // before the temp mark, the repl keeps its paths on the temporary storage
+    if (rt!=RT_MEM && !SessionEnsureWorkDir(ss)) {
+        nob_log(NOB_ERROR, "%s", "could not create a work directory");
+        IC_PHASE(PH_PREPARE);
+        RecordEval(ss, &st);
+        return -1;
+    }
+    usz i, mark = nob_temp_save();
+    int myArgsLen = 1+(int)arg->count; assert(arg->count<INT32_MAX);
+    char **myArgs = nob_temp_alloc((myArgsLen)*sizeof(char *));
+#ifdef _WIN32
+    HMODULE h = NULL;
+    struct MyHMODULEs loadedDlls = {0};
+    struct MyListOfStrings full_dlls = {0};
+#else
+    void *h = NULL;
+#endif
+
+    // args to main
+    myArgs[0] = programName!=NULL? nob_temp_strdup(programName): nob_temp_running_executable_path();
+    for (i = 0; i<arg->count; ++i) {
+        myArgs[1+i] = nob_temp_strdup(arg->items[i]);
+    }
+
+    if (rt!=RT_MEM) NextOutPath(ss);
+
+    // prepare in memory c src code
+    sbSrc->count = 0;
+    embedNs = 0;
+    bool prepared = PrepareCString(line, &ss->pre, first, &ss->src, last, sbSrc, TU_REPL);
+    st.srcBytes = sbSrc->count;
+    IC_PHASE(PH_COMPILE);
+    // Embed runs inside PrepareCString
+    st.ns[PH_PREPARE] -= embedNs;
+    st.ns[PH_EMBED] = embedNs;
+    st.at[PH_EMBED] = st.at[PH_PREPARE];
+    if (!prepared) goto end;
+    if (rt!=RT_CC) nob_sb_append_null(sbSrc);
+
+    if (rt==RT_CC && ss->compilerType==COMPILER_UNDECIDED) {
+        SetCompilerType(ss);
+    }
+
+#ifdef IC_CACHE
+    ss->builtKey = 0;
+#endif
+    if (rt!=RT_MEM && ss->prebuilt!=NULL) {
+        loadPath = ss->prebuilt;
+    }
+#ifdef IC_CACHE
+    else if (rt!=RT_MEM && ss->cacheDir!=NULL) {
+        cacheKey = CacheKey(ss, sbSrc);
+        loadPath = CacheLookup(ss->cacheDir, cacheKey);
+    }
+#endif
+    if (loadPath!=NULL) {
+        // already built by ;tm, this or another session; loaded from a private
+        // copy, dlopen would hand out a loaded instance with its globals
+        st.cached = ss->prebuilt==NULL;
+        if (!nob_copy_file(loadPath, ss->outPath.items)) goto end;
+    } else if (rt==RT_CC) {
+        Nob_Cmd cc = {0};
+        // write to inpPath
+        if (!nob_write_entire_file(ss->inpPath, sbSrc->items, sbSrc->count)) goto end;
+
+        nob_da_append(&cc, GetCompiler(ss));
+        CompilerSetup(ss, &cc);
+        if (ss->werror) {
+            TranslateWerror(ss, &cc);
+        }
+        for (usz i = 0; i<opt->count; ++i) {
+            nob_da_append(&cc, opt->items[i]);
+        }
+        // ;prof walks the frame pointer chain, leaves included
+        if (ss->framePointers) nob_cmd_append(&cc, "-fno-omit-frame-pointer", "-mno-omit-leaf-frame-pointer");
+        nob_cc_inputs(&cc, ss->inpPath);
+        TranslateDllOutput(ss, &cc);
+        nob_da_append(&cc, nob_temp_sprintf("-I%s", ss->nobDir)); // for nob.h
+
+        bool rslt = TranslateCompile(ss, &cc);
+        nob_da_free(cc);
+        if (!rslt) goto end;
+    } else {
+        // prepare quoted options
+        sbOpt->count = 0;
+        if (ss->werror) {
+            nob_sb_append_cstr(sbOpt, "-Werror ");
+        }
+        SimpleQuote(opt->items, opt->count, sbOpt);
+        nob_sb_append_null(sbOpt);
+        
+        // compile by tcc
+        s = tcc_new();
+        tcc_set_output_type(s, rt==RT_DLL? TCC_OUTPUT_DLL: TCC_OUTPUT_MEMORY);
+        tcc_set_options(s, sbOpt->items);
+        tcc_set_lib_path(s, ss->tccDir);
+        tcc_add_sysinclude_path(s, ss->incDir);
+        tcc_add_library_path(s, ss->libDir);
+    #ifndef _WIN32
+        tcc_add_library_path(s, ss->tccDir);
+    #endif
+        tcc_add_include_path(s, ss->nobDir); // for nob.h
+        if (ss->holdErrors) {
+            ss->heldErrors.count = 0;
+            tcc_set_error_func(s, ss, HoldTccError);
+        }
+
+    #ifdef _WIN32
+        if (rt==RT_MEM) {
+            if (!WinSearchDlls(opt, &full_dlls)) goto end;
+            if (!WinLoadDlls(&full_dlls, &loadedDlls)) goto end;
+            if (!WinImportDlls(s, &full_dlls, &loadedDlls)) goto end;
+        }
+    #endif
+
+        r = tcc_compile_string(s, sbSrc->items);
+        if (r==-1) goto end;
+    }
+    if (ss->holdErrors) {
+        // warnings of a batch that compiles
+        fprintf(stderr, "%.*s", (int)ss->heldErrors.count, ss->heldErrors.items);
+        ss->heldErrors.count = 0;
+    }
+
+    if (rt==RT_DLL && loadPath==NULL) {
+        r = tcc_output_file(s, ss->outPath.items);
+        if (r==-1) goto end;
+    }
+
+#ifdef IC_CACHE
+    if (rt!=RT_MEM && loadPath==NULL && ss->cacheDir!=NULL) {
+        CacheStore(ss->cacheDir, cacheKey, ss->outPath.items);
+    }
+    ss->builtKey = cacheKey;
+#endif
+    if (ss->buildOnly) {
+        r = 0;
+        goto end;
+    }
+    loadPath = ss->outPath.items;
+    IC_PHASE(PH_LOAD);
+
+    if (rt==RT_MEM) {
+        r = tcc_relocate(s);
+        if (r==-1) goto end;
+        ic_main = tcc_get_symbol(s, "ic_main");
+    } else {
+    #ifdef _WIN32
+        h = LoadLibraryA(loadPath);
+        if (h!=NULL) ic_main = (void *)GetProcAddress(h, "ic_main");
+    #else
+        h = dlopen(loadPath, RTLD_NOW);
+        if (h!=NULL) ic_main = (void *)dlsym(h, "ic_main");
+        else nob_log(NOB_ERROR, "%s", dlerror());
+    #endif
+    }
+
+    IC_PHASE(PH_TEARDOWN);
+
+    if (ic_main!=NULL) {
+        // the new unit replaces the previous one
+        SessionUnload(ss);
+        ss->state = s;
+        ss->handle = h;
+        if (rt!=RT_MEM) {
+            nob_sb_append_buf(&ss->liveRawOutPath, ss->rawOutPath.items, ss->rawOutPath.count);
+        }
+    #ifdef _WIN32
+        nob_da_append_many(&ss->loadedDlls, loadedDlls.items, loadedDlls.count);
+        loadedDlls.count = 0;
+    #endif
+        s = NULL;
+        h = NULL;
+        kept = true;
+        struct IcHost *host = SessionSymbol(ss, "__icHost");
+        if (host!=NULL) {
+            host->ctx = ss;
+            host->start = BenchStart;
+            host->next = BenchNext;
+            host->perfOpen = PerfOpen;
+            host->perfToggle = PerfToggle;
+            host->perfClose = PerfClose;
+            host->threads = ThreadScaling;
+            host->units = BenchUnits;
+            host->cycleNs = CycleNs();
+            host->sweep = SweepPoint;
+            host->fixture = FixtureGet;
+        #ifdef IC_SAMPLER
+            host->prof = ProfToggle;
+        #endif
+            // filled in by QuietEnter before ic_main
+            host->conditions = ss->quiet.on? ss->quiet.conditions: NULL;
+        }
+
+        if (ss->quiet.on) QuietEnter(ss, NULL);
+        IC_PHASE(PH_RUN);
+        struct Usage after;
+        GetUsage(&st.usage);
+        ss->ranMain = true;
+        r = ic_main(myArgsLen, myArgs);
+        // keep the order with shell commands and the host's own output
+        fflush(stdout);
+        if (ss->quiet.on) QuietLeave(ss);
+        if (ss->sweep.active) {
+            // left before its last point
+            ss->sweep.active = false;
+            ss->bench.hold = false;
+        }
+    #ifdef IC_SAMPLER
+        if (ss->sampler.active) SamplerStop(&ss->sampler);
+    #endif
+        GetUsage(&after);
+        UsageDelta(&st.usage, &after);
+        IC_PHASE(PH_TEARDOWN);
+    } else {
+        nob_log(NOB_ERROR, "%s", "failed to get compiled function");
+        r = -1;
+    }
+
+end:
+    IC_PHASE(PH_TEARDOWN);
+    if (h!=NULL) {
+    #ifdef _WIN32
+        FreeLibrary(h);
+    #else
+        dlclose(h);
+    #endif
+    }
+    // a failed compile or load
+    if (rt!=RT_MEM && !kept) RemoveOutPath(ss->rawOutPath.items);
+#ifdef _WIN32
+    for (usz i = 0; i<loadedDlls.count; ++i) {
+        FreeLibrary(loadedDlls.items[i]);
+    }
+    nob_da_free(loadedDlls);
+    nob_da_free(full_dlls);
+#endif
+    if (s!=NULL) tcc_delete(s);
+    nob_temp_rewind(mark);
+    IC_PHASE(PH_TEARDOWN);
+#undef IC_PHASE
+    // not an evaluation
+    if (ss->buildOnly) return r;
+
+    ss->runCount += 1;
+    if (!ss->ranMain) ss->errorCount += 1;
+    st.ok = ss->ranMain;
+    RecordEval(ss, &st);
+    return r;
+}
+
+void AppendLineNum(StrBuilder *sb, usz line)
+{
+    size_t mark = nob_temp_save();
+    char *buf = nob_temp_sprintf("#line %zu \"<string>\"\n", line);
+    nob_sb_append_cstr(sb, buf);
+    nob_temp_rewind(mark);
+}
+
+// the same for all timed cells, guarded for batch mode
+void AppendTimingPrelude(StrBuilder *first)
+{
+    first->count = 0;
+    nob_sb_append_cstr(first, "#ifndef __IC_TIMING\n#define __IC_TIMING\n");
+#ifdef _WIN32
+    nob_sb_append_cstr(first, "#include <windows.h>\n");
+#else
+    nob_sb_append_cstr(first, "#include <time.h>\n");
+    nob_sb_append_cstr(first, "#include <sys/resource.h>\n");
+    nob_sb_append_cstr(first,
+        "static inline double __icTvNs(struct timeval tv) { return 1e9*tv.tv_sec + 1e3*tv.tv_usec; }\n"
+        "static inline void __icPrintUsage(struct rusage *a, struct rusage *b) {"
+        "printf(\"User time: %.4gms, system time: %.4gms\\n\","
+        " (__icTvNs(b->ru_utime)-__icTvNs(a->ru_utime))/1e6, (__icTvNs(b->ru_stime)-__icTvNs(a->ru_stime))/1e6);"
+    #ifdef __APPLE__
+        "printf(\"Max RSS growth: %ldKiB\\n\", (b->ru_maxrss-a->ru_maxrss)/1024);"
+    #else
+        "printf(\"Max RSS growth: %ldKiB\\n\", b->ru_maxrss-a->ru_maxrss);"
+    #endif
+        "printf(\"Page faults: %ld minor, %ld major\\n\", b->ru_minflt-a->ru_minflt, b->ru_majflt-a->ru_majflt);"
+        "printf(\"Context switches: %ld voluntary, %ld involuntary\\n\", b->ru_nvcsw-a->ru_nvcsw, b->ru_nivcsw-a->ru_nivcsw);}\n");
+#endif
+    nob_sb_append_cstr(first, 
+        "static void __icPrintTime(double ns) {"
+        "if      (ns<1e3) printf(\"%.5gns\\n\", ns);"
+        "else if (ns<1e6) printf(\"%.4gus\\n\", ns/1e3);"
+        "else if (ns<1e9) printf(\"%.4gms\\n\", ns/1e6);"
+        "else             printf(\"%.5gs\\n\", ns/1e9);}\n");
+    nob_sb_append_cstr(first,
+        "static inline void __icPrintRate(double x, char const *unit) {"
+        "if      (x<1e3) printf(\"%.4g%s/s\", x, unit);"
+        "else if (x<1e6) printf(\"%.4gk%s/s\", x/1e3, unit);"
+        "else if (x<1e9) printf(\"%.4gM%s/s\", x/1e6, unit);"
+        "else if (x<1e12) printf(\"%.4gG%s/s\", x/1e9, unit);"
+        "else            printf(\"%.4gT%s/s\", x/1e12, unit);}\n"
+        "static inline void __icPrintThroughput(double bytes, double items, double ns) {"
+        "printf(\"Throughput: \");"
+        "if (bytes>0) __icPrintRate(bytes*1e9/ns, \"B\");"
+        "if (bytes>0 && items>0) printf(\", \");"
+        "if (items>0) __icPrintRate(items*1e9/ns, \" items\");"
+        "printf(\"\\n\");}\n");
+    nob_sb_append_cstr(first,
+        "static inline void __icCheckCycle(double ns) {"
+        "if (ns<__icHost.cycleNs) printf(\"warning: less than a cpu cycle (%.2gns) per iteration,"
+        " the optimizer probably removed the work, KEEP(x) its result\\n\", __icHost.cycleNs);}\n");
+    nob_sb_append_cstr(first, "#endif\n");
+}
+
+// --bytes and --items, evaluated once before timing
+void AppendUnits(StrBuilder *last, struct TimeOptions *to, bool toHost)
+{
+    if (to->bytes[0]=='\0' && to->items[0]=='\0') return;
+    nob_sb_appendf(last, "double __icBytes = (%s), __icItems = (%s);\n",
+        to->bytes[0]!='\0'? to->bytes: "0", to->items[0]!='\0'? to->items: "0");
+    if (toHost) {
+        nob_sb_append_cstr(last, "if (__icHost.units!=NULL) __icHost.units(__icHost.ctx, __icBytes, __icItems);\n");
+    }
+}
+
+void AppendTiming(StrBuilder *first, StrBuilder *last, usz line, struct TimeOptions *to, StrBuilder *reps, StrBuilder *out)
+{
+    bool once = to->once;
+    AppendTimingPrelude(first);
+    last->count = 0;
+    AppendLineNum(last, 1+line);
+    AppendUnits(last, to, to->bench || to->threadsCount>0);
+    if (to->threadsCount>0) {
+        // a function for the threads of the host, it sees globals but not the locals of ic_main
+        nob_sb_appendf(first, "static void __icThreads%zu(uint64_t __icReps, int ic_thread) {\n(void)ic_thread;\n", line);
+        nob_sb_append_cstr(first, "for (uint64_t __icI = 0; __icI<__icReps; ++__icI) {\n");
+        AppendLineNum(first, 1+line);
+        nob_sb_append_buf(first, out->items, out->count);
+        nob_sb_append_cstr(first, "\n}\n}\n");
+        nob_sb_append_cstr(last, "if (__icHost.threads!=NULL) __icHost.threads(__icHost.ctx, \"");
+        FormatTimeOptions(to, last);
+        nob_sb_appendf(last, "\", __icThreads%zu);\n", line);
+        return;
+    }
+#ifndef _WIN32
+    if (to->rusage) {
+        nob_sb_append_cstr(last, "struct rusage __icUsageStart, __icUsageEnd;\n");
+        nob_sb_append_cstr(last, "getrusage(RUSAGE_SELF, &__icUsageStart);\n");
+    }
+#endif
+    if (to->perfEvents!=0) {
+        nob_sb_appendf(last, "int __icPerf = __icHost.perfOpen!=NULL && __icHost.perfOpen(__icHost.ctx, %"PRIu32"u);\n",
+            to->perfEvents);
+    }
+    if (to->bench) {
+        // the host decides the reps of every batch, see BenchNext()
+        nob_sb_append_cstr(last, "int __icVariant = 0;\n");
+        nob_sb_append_cstr(last, "uint64_t __icReps = __icHost.start==NULL? 0: __icHost.start(__icHost.ctx, \"");
+        FormatTimeOptions(to, last);
+        nob_sb_append_cstr(last, "\", \"\", ");
+        if (once) nob_sb_append_cstr(last, "0");
+        else nob_sb_append_buf(last, reps->items, reps->count);
+        nob_sb_append_cstr(last, ", &__icVariant);\n");
+        nob_sb_append_cstr(last, "while (__icReps>0) {\n");
+    }
+#ifdef _WIN32
+    nob_sb_append_cstr(last, "LARGE_INTEGER __icFreq, __icStart, __icEnd;\n");
+    nob_sb_append_cstr(last, "QueryPerformanceFrequency(&__icFreq);\n");
+#else
+    nob_sb_append_cstr(last, "struct timespec __icStart, __icEnd;\n");
+#endif
+    if (!once && !to->bench) {
+        nob_sb_append_cstr(last, "uint64_t __icReps = (");
+        nob_sb_append_buf(last, reps->items, reps->count);
+        nob_sb_append_cstr(last, ");\n");
+    }
+    if (to->perfEvents!=0) {
+        nob_sb_append_cstr(last, "if (__icPerf) __icHost.perfToggle(__icHost.ctx, 1, 0);\n");
+    }
+#ifdef _WIN32
+    nob_sb_append_cstr(last, "QueryPerformanceCounter(&__icStart);\n");
+#else
+    nob_sb_append_cstr(last, "clock_gettime(CLOCK_MONOTONIC, &__icStart);\n");
+#endif
+    if (!once || to->bench) {
+        nob_sb_append_cstr(last, "for (uint64_t __icI = 0; __icI<__icReps; ++__icI) {\n");
+    }
+    nob_sb_append_buf(last, out->items, out->count);
+    if (!once || to->bench) {
+        nob_sb_append_cstr(last, "}\n");
+    }
+#ifdef _WIN32
+    nob_sb_append_cstr(last, "QueryPerformanceCounter(&__icEnd);\n");
+    nob_sb_append_cstr(last, "double __icTimeNs = "
+        "1e9 * (__icEnd.QuadPart - __icStart.QuadPart) / __icFreq.QuadPart;\n");
+#else
+    nob_sb_append_cstr(last, "clock_gettime(CLOCK_MONOTONIC, &__icEnd);\n");
+    nob_sb_append_cstr(last, "double __icTimeNs = "
+        "1e9 * (__icEnd.tv_sec - __icStart.tv_sec) + (__icEnd.tv_nsec - __icStart.tv_nsec);\n");
+#endif
+    if (to->perfEvents!=0) {
+        nob_sb_appendf(last, "if (__icPerf) __icHost.perfToggle(__icHost.ctx, 0, %s);\n",
+            once && !to->bench? "1": "__icReps");
+    }
+    if (to->bench) {
+        nob_sb_append_cstr(last, "__icReps = __icHost.next(__icHost.ctx, &__icVariant, __icReps, __icTimeNs);\n");
+        nob_sb_append_cstr(last, "}\n");
+    }
+#ifndef _WIN32
+    if (to->rusage) {
+        nob_sb_append_cstr(last, "getrusage(RUSAGE_SELF, &__icUsageEnd);\n");
+    }
+#endif
+    if (!to->bench) {
+        nob_sb_append_cstr(last, "printf(\"Elapsed time: \");__icPrintTime(__icTimeNs);\n");
+        if (!once) {
+            nob_sb_append_cstr(last, "printf(\"Average time: \");__icPrintTime(__icTimeNs/__icReps);\n");
+            nob_sb_append_cstr(last, "__icCheckCycle(__icTimeNs/__icReps);\n");
+        }
+        if (to->bytes[0]!='\0' || to->items[0]!='\0') {
+            nob_sb_appendf(last, "__icPrintThroughput(__icBytes, __icItems, __icTimeNs/%s);\n", once? "1": "__icReps");
+        }
+        nob_sb_append_cstr(last, "if (__icHost.conditions!=NULL) printf(\"Conditions: %s\\n\", __icHost.conditions);\n");
+    }
+#ifdef _WIN32
+    if (to->rusage) printf("--rusage is not supported on windows, see ;stats and IC_TRACE\n");
+#else
+    if (to->rusage) {
+        nob_sb_append_cstr(last, "__icPrintUsage(&__icUsageStart, &__icUsageEnd);\n");
+    }
+#endif
+    if (to->perfEvents!=0) {
+        nob_sb_append_cstr(last, "if (__icPerf) __icHost.perfClose(__icHost.ctx);\n");
+    }
+}
+
+// ;bench, cases switches over the variants
+void AppendBench(StrBuilder *first, StrBuilder *last, usz line, struct TimeOptions *to, StrBuilder *labels, StrBuilder *cases)
+{
+    AppendTimingPrelude(first);
+    last->count = 0;
+    AppendLineNum(last, 1+line);
+    AppendUnits(last, to, true);
+#ifndef _WIN32
+    if (to->rusage) {
+        nob_sb_append_cstr(last, "struct rusage __icUsageStart, __icUsageEnd;\n");
+        nob_sb_append_cstr(last, "getrusage(RUSAGE_SELF, &__icUsageStart);\n");
+    }
+#endif
+    nob_sb_append_cstr(last, "int __icVariant = 0;\n");
+    nob_sb_append_cstr(last, "uint64_t __icReps = __icHost.start==NULL? 0: __icHost.start(__icHost.ctx, \"");
+    FormatTimeOptions(to, last);
+    nob_sb_append_cstr(last, "\", \"");
+    for (usz i = 0; i<labels->count; ++i) {
+        if (labels->items[i]=='\n') nob_sb_append_cstr(last, "\\n");
+        else nob_da_append(last, labels->items[i]);
+    }
+    nob_sb_append_cstr(last, "\", 0, &__icVariant);\n");
+    nob_sb_append_cstr(last, "while (__icReps>0) {\n");
+#ifdef _WIN32
+    nob_sb_append_cstr(last, "LARGE_INTEGER __icFreq, __icStart, __icEnd;\n");
+    nob_sb_append_cstr(last, "QueryPerformanceFrequency(&__icFreq);\n");
+    nob_sb_append_cstr(last, "QueryPerformanceCounter(&__icStart);\n");
+#else
+    nob_sb_append_cstr(last, "struct timespec __icStart, __icEnd;\n");
+    nob_sb_append_cstr(last, "clock_gettime(CLOCK_MONOTONIC, &__icStart);\n");
+#endif
+    nob_sb_append_cstr(last, "switch (__icVariant) {\n");
+    nob_sb_append_buf(last, cases->items, cases->count);
+    nob_sb_append_cstr(last, "}\n");
+#ifdef _WIN32
+    nob_sb_append_cstr(last, "QueryPerformanceCounter(&__icEnd);\n");
+    nob_sb_append_cstr(last, "double __icTimeNs = "
+        "1e9 * (__icEnd.QuadPart - __icStart.QuadPart) / __icFreq.QuadPart;\n");
+#else
+    nob_sb_append_cstr(last, "clock_gettime(CLOCK_MONOTONIC, &__icEnd);\n");
+    nob_sb_append_cstr(last, "double __icTimeNs = "
+        "1e9 * (__icEnd.tv_sec - __icStart.tv_sec) + (__icEnd.tv_nsec - __icStart.tv_nsec);\n");
+#endif
+    nob_sb_append_cstr(last, "__icReps = __icHost.next(__icHost.ctx, &__icVariant, __icReps, __icTimeNs);\n");
+    nob_sb_append_cstr(last, "}\n");
+#ifdef _WIN32
+    if (to->rusage) printf("--rusage is not supported on windows, see ;stats and IC_TRACE\n");
+#else
+    if (to->rusage) {
+        nob_sb_append_cstr(last, "getrusage(RUSAGE_SELF, &__icUsageEnd);\n");
+        nob_sb_append_cstr(last, "__icPrintUsage(&__icUsageStart, &__icUsageEnd);\n");
+    }
+#endif
+}
+
+// `label: stmt`, the label is optional
+void ChopBenchLabel(StrBuilder *out, StrBuilder *label)
+{
+    usz i = 0, n;
+    while (i<out->count && isspace((unsigned char)out->items[i])) ++i;
+    n = i;
+    while (n<out->count && (isalnum((unsigned char)out->items[n]) || out->items[n]=='_')) ++n;
+    if (n==i || isdigit((unsigned char)out->items[i])) return;
+    usz colon = n;
+    while (colon<out->count && (out->items[colon]==' ' || out->items[colon]=='\t')) ++colon;
+    if (colon>=out->count || out->items[colon]!=':' || (colon+1<out->count && out->items[colon+1]==':')) return;
+    label->count = 0;
+    nob_sb_append_buf(label, out->items+i, n-i);
+    memmove(out->items, out->items+colon+1, out->count-colon-1);
+    out->count -= colon+1;
+}
+
+// a timed expression goes into KEEP, otherwise cc -O2 may drop its work;
+// __icSink lets void calls through
+void SinkExpr(StrBuilder *out)
+{
+    static char const prefix[] = "__icSink((";
+    usz n = out->count-1; // without the newline
+    nob_da_reserve(out, out->count+sizeof(prefix));
+    memmove(out->items+sizeof(prefix)-1, out->items, n);
+    memcpy(out->items, prefix, sizeof(prefix)-1);
+    out->count = sizeof(prefix)-1+n;
+    nob_sb_append_cstr(out, "));\n");
+}
+
+// ;bench [n] [--option...] followed by n statements, fills first and last
+bool ReadBench(Session *ss, Nob_String_View args, usz *outLine)
+{
+    StrBuilder *out = &ss->out;
+    struct TimeOptions to;
+    usz n = 2;
+    if (args.count>0 && isdigit((unsigned char)args.data[0])) {
+        Nob_String_View num = nob_sv_chop_by_delim(&args, ' ');
+        size_t mark = nob_temp_save();
+        n = (usz)strtoul(nob_temp_sv_to_cstr(num), NULL, 10);
+        nob_temp_rewind(mark);
+    }
+    if (n<2 || n>IC_BENCH_MAX) {
+        printf("\""CMD_SIGN"bench\" compares 2 to %d statements\n", (int)IC_BENCH_MAX);
+        return false;
+    }
+    if (!ParseTimeOptions(args, &to, NULL)) return false;
+    to.bench = true;
+    if (to.save[0]!='\0' || to.compare[0]!='\0') SetupDataPaths();
+    if (to.perfEvents!=0) {
+        printf("Counters are per \""CMD_SIGN"t --perf\", ignored\n");
+        to.perfEvents = 0;
+    }
+
+    StrBuilder labels = {0}, label = {0}, cases = {0};
+    bool ok = true;
+    if (ss->batch) ss->line = *outLine;
+    *outLine = ss->line;
+    for (usz i = 0; i<n; ++i) {
+        usz line = *outLine;
+        enum InputKind kind = GetInput(out, outLine, false, true);
+        if (kind!=Stmt && kind!=Expr) {
+            printf("Expected %zu statements after \""CMD_SIGN"bench\"\n", n);
+            ok = false;
+            break;
+        }
+        label.count = 0;
+        nob_da_append(&label, (char)('A'+i));
+        ChopBenchLabel(out, &label);
+        if (kind==Expr) SinkExpr(out);
+        if (i>0) nob_da_append(&labels, '\n');
+        nob_sb_append_buf(&labels, label.items, label.count<31? label.count: 31);
+        nob_sb_appendf(&cases, "case %zu:\nfor (uint64_t __icI = 0; __icI<__icReps; ++__icI) {\n", i);
+        AppendLineNum(&cases, 1+line);
+        nob_sb_append_buf(&cases, out->items, out->count);
+        nob_sb_append_cstr(&cases, "\n}\nbreak;\n");
+    }
+    if (ok) AppendBench(&ss->first, &ss->last, ss->line, &to, &labels, &cases);
+    nob_sb_free(labels);
+    nob_sb_free(label);
+    nob_sb_free(cases);
+    return ok;
+}
+
+// N=1e3..1e7*10 (multiplying), N=0..100+10 (adding) or N=1,2,4 (a list)
+bool ParseSweepValues(Nob_String_View sv, char *name, usz nameSize, double *values, usz *count)
+{
+    size_t mark = nob_temp_save();
+    bool ok = false;
+    Nob_String_View id = nob_sv_trim(nob_sv_chop_by_delim(&sv, '='));
+    if (id.count==0 || id.count>=nameSize || isdigit((unsigned char)id.data[0])) goto end;
+    for (usz i = 0; i<id.count; ++i) {
+        if (!isalnum((unsigned char)id.data[i]) && id.data[i]!='_') goto end;
+    }
+    snprintf(name, nameSize, SV_Fmt, SV_Arg(id));
+    char const *spec = nob_temp_sv_to_cstr(sv);
+    char *end;
+    *count = 0;
+    char const *dots = strstr(spec, "..");
+    if (dots==NULL) {
+        // a list
+        do {
+            if (*count==IC_SWEEP_MAX) goto end;
+            values[(*count)++] = strtod(spec, &end);
+            if (end==spec) goto end;
+            spec = end;
+        } while (*spec++==',');
+        ok = spec[-1]=='\0';
+        goto end;
+    }
+    // each side on its own, strtod takes the first '.' of ".." for a decimal point
+    char const *fromText = nob_temp_sv_to_cstr(nob_sv_trim(nob_sv_from_parts(spec, dots-spec)));
+    double from = strtod(fromText, &end);
+    if (end==fromText || *end!='\0') goto end;
+    double to = strtod(dots+2, &end);
+    if (end==dots+2) goto end;
+    char op = *end!='\0'? *end++: '*';
+    double step = *end!='\0'? strtod(end, &end): 2;
+    if (*end!='\0' || (op!='*' && op!='+')) goto end;
+    if (op=='*'? from<=0 || step<=1: step<=0) goto end;
+    for (usz k = 0; ; ++k) {
+        double x = op=='*'? from*pow(step, (double)k): from+step*k;
+        if (x>to*(1+1e-9)) break;
+        if (*count==IC_SWEEP_MAX) goto end;
+        values[(*count)++] = round(x);
+    }
+    ok = *count>0;
+end:
+    nob_temp_rewind(mark);
+    return ok;
+}
+
+// the statement in out timed by the harness of ;t --bench for each value bound to name
+void AppendSweep(StrBuilder *first, StrBuilder *last, usz line, struct TimeOptions *to,
+    char const *name, double *values, usz count, StrBuilder *out)
+{
+    StrBuilder body = {0}, none = {0};
+    AppendTiming(first, &body, line, to, &none, out);
+    last->count = 0;
+    AppendLineNum(last, 1+line);
+    nob_sb_append_cstr(last, "static double const __icSweepValues[] = {");
+    for (usz i = 0; i<count; ++i) nob_sb_appendf(last, "%s%.17g", i>0? ",": "", values[i]);
+    nob_sb_append_cstr(last, "};\n");
+    nob_sb_appendf(last, "for (int __icSweep = 0; __icSweep<%zu; ++__icSweep) {\n", count);
+    nob_sb_appendf(last, "long long %s = (long long)__icSweepValues[__icSweep]; (void)%s;\n", name, name);
+    nob_sb_appendf(last, "if (__icHost.sweep!=NULL) __icHost.sweep(__icHost.ctx, (double)%s);\n", name);
+    nob_sb_append_buf(last, body.items, body.count);
+    nob_sb_append_cstr(last, "}\n");
+    nob_sb_append_cstr(last, "if (__icHost.sweep!=NULL) __icHost.sweep(__icHost.ctx, -1);\n");
+    nob_sb_free(body);
+}
+
+// ;sweep N=values [--csv=path] [--option...] followed by a statement, fills first and last
+bool ReadSweep(Session *ss, Nob_String_View args, usz *outLine)
+{
+    StrBuilder *out = &ss->out, options = {0};
+    struct TimeOptions to;
+    double values[IC_SWEEP_MAX];
+    usz count = 0;
+    bool ok = false;
+    struct Sweep *sw = &ss->sweep;
+    Nob_String_View spec = nob_sv_chop_by_delim(&args, ' ');
+    if (!ParseSweepValues(spec, sw->name, sizeof(sw->name), values, &count)) {
+        printf("Usage: "CMD_SIGN"sweep N=1e3..1e7*10 [--csv=path] [--option...], up to %d values\n", (int)IC_SWEEP_MAX);
+        return false;
+    }
+    sw->csv[0] = '\0';
+    while (args.count>0) {
+        Nob_String_View word = nob_sv_chop_by_delim(&args, ' ');
+        args = nob_sv_trim_left(args);
+        if (nob_sv_starts_with(word, nob_sv_from_cstr("--csv="))) {
+            snprintf(sw->csv, sizeof(sw->csv), SV_Fmt, (int)word.count-6, word.data+6);
+        } else {
+            nob_sb_append_buf(&options, word.data, word.count);
+            nob_da_append(&options, ' ');
+        }
+    }
+    if (!ParseTimeOptions(nob_sv_from_parts(options.items, options.count), &to, NULL)) goto end;
+    if (to.threadsCount>0) {
+        printf("\""CMD_SIGN"sweep\" does not take threads\n");
+        goto end;
+    }
+    if (to.save[0]!='\0' || to.compare[0]!='\0') {
+        printf("\""CMD_SIGN"sweep\" does not take --save or --compare, see --csv=\n");
+        goto end;
+    }
+    to.bench = true;
+
+    if (ss->batch) ss->line = *outLine;
+    *outLine = ss->line;
+    enum InputKind kind = GetInput(out, outLine, false, true);
+    if (kind==Expr) {
+        SinkExpr(out);
+    } else if (kind!=Stmt) {
+        printf("Expected statement or expression after \""CMD_SIGN"sweep\"\n");
+        goto end;
+    }
+    AppendSweep(&ss->first, &ss->last, ss->line, &to, sw->name, values, count, out);
+    ok = true;
+end:
+    nob_sb_free(options);
+    return ok;
+}
+
+// ;prof [--hz=1000] [--min-time=0] [--folded=path] followed by a statement, fills first and last
+bool ReadProf(Session *ss, Nob_String_View args, usz *outLine)
+{
+#ifndef IC_SAMPLER
+    (void)ss;
+    (void)args;
+    (void)outLine;
+    printf("\""CMD_SIGN"prof\" is not supported on this platform\n");
+    return false;
+#else
+    StrBuilder *out = &ss->out, *last = &ss->last;
+    struct Sampler check;
+    if (!ParseProfOptions(args, &check)) return false;
+    // for the unit, args is in out which gets the statement
+    StrBuilder options = {0};
+    for (usz i = 0; i<args.count; ++i) {
+        if (args.data[i]=='"' || args.data[i]=='\\') nob_da_append(&options, '\\');
+        nob_da_append(&options, args.data[i]);
+    }
+
+    if (ss->batch) ss->line = *outLine;
+    *outLine = ss->line;
+    enum InputKind kind = GetInput(out, outLine, false, true);
+    if (kind==Expr) {
+        SinkExpr(out);
+    } else if (kind!=Stmt) {
+        printf("Expected statement or expression after \""CMD_SIGN"prof\"\n");
+        nob_sb_free(options);
+        return false;
+    }
+    ss->first.count = 0;
+    last->count = 0;
+    // no line marker before the loop, the statement is the only code at its line
+    nob_sb_append_cstr(last, "if (__icHost.prof!=NULL) __icHost.prof(__icHost.ctx, \"");
+    nob_sb_append_buf(last, options.items, options.count);
+    nob_sb_appendf(last, "\", %zu);\ndo {\n", 1+ss->line);
+    AppendLineNum(last, 1+ss->line);
+    nob_sb_append_buf(last, out->items, out->count);
+    nob_sb_append_cstr(last, "\n} while (__icHost.prof!=NULL && __icHost.prof(__icHost.ctx, NULL, 0));\n");
+    nob_sb_free(options);
+    ss->framePointers = true;
+    return true;
+#endif
+}
+
+#define IC_MATRIX_DEFAULT "tcc, -O0, -O2, -O3 -march=native"
+#define IC_MATRIX_DEFAULT_CL "tcc, /Od, /O2, /O2 /arch:AVX2"
+
+// a column of ;tm, tcc in memory or the compiler with extra flags
+struct MatrixConfig {
+    char label[32];
+    bool tcc;
+    Nob_Cmd flags;
+    char const *rawPath; // of the prebuilt unit
+};
+
+// ;tm: the cell in first and last under each configuration, the cc ones
+// are compiled in parallel beforehand, the timed runs go one by one
+void TimingMatrix(Session *ss, Nob_String_View configs, StrBuilder *first, StrBuilder *last)
+{
+    struct MatrixConfig cfg[IC_BENCH_MAX] = {0};
+    struct Bench m = {0};
+    usz n = 0;
+    RunType rt = ss->rt;
+    usz optCount = ss->opt.count;
+    StrBuilder src = {0}, errors = {0};
+    Nob_Cmd cc = {0};
+    Nob_Procs procs = {0};
+    if (!SessionEnsureWorkDir(ss)) {
+        nob_log(NOB_ERROR, "%s", "could not create a work directory");
+        return;
+    }
+    size_t mark = nob_temp_save();
+    if (ss->compilerType==COMPILER_UNDECIDED) SetCompilerType(ss);
+    if (configs.count==0) {
+        configs = nob_sv_from_cstr(ss->compilerType==CL_EXE? IC_MATRIX_DEFAULT_CL: IC_MATRIX_DEFAULT);
+    }
+    while (configs.count>0) {
+        Nob_String_View c = nob_sv_trim(nob_sv_chop_by_delim(&configs, ','));
+        if (c.count==0) continue;
+        if (n==IC_BENCH_MAX) {
+            printf("\""CMD_SIGN"tm\" times at most %d configurations\n", (int)IC_BENCH_MAX);
+            goto end;
+        }
+        struct MatrixConfig *mc = &cfg[n++];
+        snprintf(mc->label, sizeof(mc->label), SV_Fmt, SV_Arg(c));
+        mc->tcc = nob_sv_starts_with(c, nob_sv_from_cstr("tcc")) && (c.count==3 || isspace((unsigned char)c.data[3]));
+        if (mc->tcc) nob_sv_chop_left(&c, 3);
+        c = nob_sv_trim(c);
+        if (c.count>0) ParseShell(c.data, c.count, &mc->flags);
+    }
+    if (n==0) goto end;
+
+    // all cc configurations at once, each process on a core of its own
+    usz built = 0;
+    uint64_t t = nob_nanos_since_unspecified_epoch();
+    if (!PrepareCString(ss->line, &ss->pre, first, &ss->src, last, &src, TU_REPL)) goto end;
+    char const *srcPath = nob_temp_sprintf("%s/_tm.c", ss->workDir);
+    if (!nob_write_entire_file(srcPath, src.items, src.count)) goto end;
+    for (usz i = 0; i<n; ++i) {
+        struct MatrixConfig *mc = &cfg[i];
+        if (mc->tcc) continue;
+        mc->rawPath = nob_temp_sprintf("%s/_tm%zu", ss->workDir, i);
+        RemoveOutPath(mc->rawPath);
+        nob_da_append(&cc, GetCompiler(ss));
+        CompilerSetup(ss, &cc);
+        if (ss->werror) TranslateWerror(ss, &cc);
+        nob_da_append_many(&cc, ss->opt.items, ss->opt.count);
+        nob_da_append_many(&cc, mc->flags.items, mc->flags.count);
+        nob_cc_inputs(&cc, srcPath);
+        if (ss->compilerType==CL_EXE) {
+            nob_cmd_append(&cc, "/LD", nob_temp_sprintf("/Fo:%s", mc->rawPath), nob_temp_sprintf("/Fe:%s", mc->rawPath));
+        } else {
+            nob_cmd_append(&cc, "-shared", "-o", nob_temp_sprintf("%s%s", mc->rawPath, dllExt));
+        }
+        nob_da_append(&cc, nob_temp_sprintf("-I%s", ss->nobDir));
+        char const *errPath = nob_temp_sprintf("%s.txt", mc->rawPath);
+        // cl.exe reports errors on stdout
+        nob_cmd_run(&cc, .async=&procs, .max_procs=CpuCount(),
+            .stdout_path=ss->compilerType==CL_EXE? errPath: NULL, .stderr_path=errPath);
+        built += 1;
+    }
+    nob_procs_wait(procs);
+    if (built>0) {
+        printf("compiled %zu configurations in %s on %zu cores\n", built,
+            FormatNs((double)(nob_nanos_since_unspecified_epoch()-t)), CpuCount());
+    }
+
+    // timed runs one after another, the cc ones load their prebuilt unit
+    m.hold = true;
+    ss->bench.hold = true;
+    for (usz i = 0; i<n; ++i) {
+        struct MatrixConfig *mc = &cfg[i];
+        char const *path = NULL;
+        if (!mc->tcc) {
+            path = nob_temp_sprintf("%s%s", mc->rawPath, dllExt);
+            if (nob_file_exists(path)!=1) {
+                printf("%s: could not compile\n", mc->label);
+                errors.count = 0;
+                if (nob_read_entire_file(nob_temp_sprintf("%s.txt", mc->rawPath), &errors)) {
+                    printf("%.*s", (int)errors.count, errors.items);
+                }
+                continue;
+            }
+        }
+        ss->rt = mc->tcc? RT_MEM: RT_CC;
+        ss->prebuilt = path;
+        ss->opt.count = optCount;
+        if (mc->tcc) nob_da_append_many(&ss->opt, mc->flags.items, mc->flags.count);
+        ss->bench.variants[0].samples.count = 0;
+        printf("%s\n", mc->label);
+        fflush(stdout);
+        int r = Run(ss, ss->line, first, last);
+        ss->rt = rt;
+        ss->prebuilt = NULL;
+        ss->opt.count = optCount;
+        struct BenchVariant *v = &ss->bench.variants[0];
+        if (r<0 || v->samples.count==0) {
+            printf("%s: did not run\n", mc->label);
+            continue;
+        }
+        struct BenchVariant *to = &m.variants[m.count++];
+        memcpy(to->label, mc->label, sizeof(to->label));
+        to->reps = v->reps;
+        nob_da_append_many(&to->samples, v->samples.items, v->samples.count);
+        if (ss->bench.warmupNs>m.warmupNs) m.warmupNs = ss->bench.warmupNs;
+        m.bytes = ss->bench.bytes;
+        m.conditions = ss->bench.conditions;
+        m.items = ss->bench.items;
+    }
+    ss->bench.hold = false;
+    ss->bench.bytes = ss->bench.items = 0;
+    if (m.count>0) BenchReport(&m);
+    for (usz i = 0; i<m.count; ++i) nob_da_free(m.variants[i].samples);
+
+end:
+    for (usz i = 0; i<n; ++i) {
+        if (cfg[i].rawPath!=NULL) {
+            RemoveOutPath(cfg[i].rawPath);
+            Nob_Log_Level old = nob_minimal_log_level;
+            nob_minimal_log_level = NOB_NO_LOGS;
+            nob_delete_file(nob_temp_sprintf("%s.txt", cfg[i].rawPath));
+            nob_minimal_log_level = old;
+        }
+        nob_da_free(cfg[i].flags);
+    }
+    nob_sb_free(src);
+    nob_sb_free(errors);
+    nob_da_free(cc);
+    nob_da_free(procs);
+    nob_temp_rewind(mark);
+}
+
+void Help(void)
+{
+    printf("%s",
+        "Commands:\n"
+        CMD_SIGN"h      -- show this help message\n"
+        CMD_SIGN"q      -- quit\n"
+        CMD_SIGN"l      -- list recorded code\n"
+        CMD_SIGN"c      -- clear recorded code\n"
+        CMD_SIGN"o      -- list current compiler options\n"
+        CMD_SIGN"o[...] -- append new compiler options\n"
+        CMD_SIGN"O      -- clear compiler options\n"
+        CMD_SIGN"a      -- list current arguments\n"
+        CMD_SIGN"a[...] -- append new arguments\n"
+        CMD_SIGN"A      -- clear arguments\n"
+        CMD_SIGN"p expr -- print a struct or array\n"
+        CMD_SIGN"P x,sz -- print memory x with size sz\n"
+        CMD_SIGN"t[:n]  -- time the following statement\n"
+        "          --rusage: also cpu times, page faults and context switches\n"
+        "          --bench: warmup, calibrated reps and statistics of samples\n"
+        "          --warmup=100ms --min-time=10ms --samples=20 --max-time=5s\n"
+        "          --perf[=cycles,instructions,...]: hardware counters per iteration\n"
+        "          --bytes=expr --items=expr: throughput, expr per iteration\n"
+        "          --save name: keep the results, --compare name: flag changes against them\n"
+        CMD_SIGN"t@1,2,4 -- the statement on 1, 2 and 4 threads, it sees globals and ic_thread\n"
+        CMD_SIGN"tm[:tcc, -O0, -O2, -O3 -march=native] [--option...] -- time the statement\n"
+        "          under each configuration, tcc or cc with the flags added to the options\n"
+        CMD_SIGN"f      -- start a top level statement\n"
+        CMD_SIGN"m expr -- print out expanded macros\n"
+        CMD_SIGN";      -- rerun the recorded code\n"
+        CMD_SIGN"r[mdc] -- run as memory (m), dll (d) or use cc (c)\n"
+        CMD_SIGN"w      -- warnings as errors (default)\n"
+        CMD_SIGN"W      -- warnings not as errors\n"
+        CMD_SIGN"save name     -- save the session and its compiled module\n"
+        CMD_SIGN"restore name  -- replace the session by a saved one\n"
+        CMD_SIGN"export out.c  -- write the session as a standalone program\n"
+        CMD_SIGN"build out ... -- compile it (-O2 by default), a library if out is .so/.dll\n"
+        CMD_SIGN"watch file... -- rerun the last cell whenever a file is saved\n"
+        CMD_SIGN"replay-profile [n | reset] -- time each recorded line over n replays\n"
+        CMD_SIGN"stats [n | reset]          -- time spent per phase by the last n evaluations\n"
+        CMD_SIGN"bench [n] [--option...]    -- compare the n (2) following `label: statement`s\n"
+        CMD_SIGN"sweep N=1e3..1e7*10 [--csv=path] [--option...] -- time the following statement\n"
+        "          for each N (*10 or +step, or a list 1,2,4), fit its complexity and plot it\n"
+        CMD_SIGN"quiet [cpu] [--priority]   -- pin evaluations to a cpu (the last), lock memory, check the clock\n"
+        CMD_SIGN"quiet off                  -- back to normal evaluations\n"
+        CMD_SIGN"fixtures [clear]           -- list the FIXTURE_* data kept between evaluations, or free it\n"
+        CMD_SIGN"prof [--hz=1000] [--min-time=0] [--folded=path] -- sample the following statement,\n"
+        "          print the functions and lines it spends its cpu time in, folded stacks for flamegraphs\n"
+        SHL_SIGN"[...]  -- execute shell command\n"
+        CPP_SIGN"[...]  -- C preprocessor\n"
+        "Macros:\n"
+        "  ONCE_LINE  -- true only the first time on the line\n"
+        "  ONCE       -- execute the following statement only once\n"
+        "  PRINT(X);  -- print the value of X\n"
+        "  BIN(X)     -- get binary representation of integer X\n"
+        "  FORMAT(X, ...)  -- get formatted string\n"
+        "  WIDE(X)    -- format wide string X to a printable string\n"
+        "  KEEP(X);   -- the optimizer must compute X, "CMD_SIGN"t does it for expressions\n"
+        "  CLOBBER(); -- the optimizer must assume that all memory is read and written\n"
+        "  FIXTURE_RAND_U32(a, n, seed); -- uint32_t const *a, n random numbers made once\n"
+        "                                   and kept between evaluations, also _U64 and _F64 in [0,1)\n"
+        "  FIXTURE_FILE(f, path); -- unsigned char const *f and size_t f_size, the file mapped\n"
+        "                           once and again when it changes, NULL if it can't be read\n"
+    );
+}
+
+void CompleteFunc(char const *buf, int cursorPos, mlCompletions *comp, void *userdata)
+{
+    static char const *const cpp[] = {
+        "define", "undef", "if", "ifdef", "ifndef", "else", "elif", "endif",
+        "include", "embed", "line", "error", "pragma",
+    };
+
+    static char const *const keywords[] = {
+        "if", "else", 
+        "for", "do", "while",
+        "switch", "case", "default", 
+        "return", "goto", "auto",
+    };
+
+    static char const *const stmtLike[] = {
+        "break", "continue",
+    };
+
+    static char const *const typeLike[] = {
+        "int", "char", "float", "double", "void", "short", "long", "signed",
+        "unsigned", "struct", "union", "enum", "const", "volatile", "static",
+        "extern", "register", "inline", "restrict",
+        // C11
+        "bool",
+        // known types
+        "size_t", "ssize_t", "wchar_t",
+        "int8_t", "int16_t", "int32_t", "int64_t",
+        "uint8_t", "uint16_t", "uint32_t", "uint64_t",
+        // stdint.h
+        "intmax_t", "intptr_t", "uintmax_t", "uintptr_t",
+        // defined by me
+        "ONCE",
+    };
+
+    static char const *const funcLike[] = {
+        // standard functions
+        "printf", "scanf", "malloc", "free", "realloc", "calloc",
+        "memcpy", "memset", "puts", "putchar",
+        "atoi", "atol", "atoll", "strtol", "strtoll",
+        "strtoul", "strtoull", "strcpy", "strncpy", "strlen",
+        // math functions
+        "sin", "cos", "tan", "asin", "acos", "atan", "atan2",
+        "exp", "pow", "log", "sqrt", "cbrt", "lgamma", "tgamma",
+        "abs", "labs", "llabs", "fabs", "fmod", "fmin", "fmax",
+        "ceil", "floor", "round", "trunc",
+        // inttypes.h
+        "INT8_C", "INT16_C", "INT32_C", "INT64_C",
+        "UINT8_C", "UINT16_C", "UINT32_C", "UINT64_C",
+        // others
+        "sizeof", "alignof", "alignas",
+        // defined by me
+        "BIN", "FORMAT", "WIDE", "PRINT", "KEEP", "CLOBBER",
+        "FIXTURE_RAND_U32", "FIXTURE_RAND_U64", "FIXTURE_RAND_F64", "FIXTURE_FILE",
+    };
+
+    static char const *const constLike[] = {
+        "NULL", "true", "false",
+        "SIZE_MAX", "WCHAR_MAX", "WCHAR_MIN",
+        "CHAR_BIT", "SCHAR_MAX", "SCHAR_MIN", "UCHAR_MAX",
+        // inttypes.h
+        "INT8_MAX", "INT16_MAX", "INT32_MAX", "INT64_MAX",
+        "INT8_MIN", "INT16_MIN", "INT32_MIN", "INT64_MIN",
+        "UINT8_MAX", "UINT16_MAX", "UINT32_MAX", "UINT64_MAX",
+        "PRId8", "PRId16", "PRId32", "PRId64", "PRIdPTR",
+        "PRIu8", "PRIu16", "PRIu32", "PRIu64", "PRIuPTR",
+        "PRIx8", "PRIx16", "PRIx32", "PRIx64", "PRIxPTR",
+        "SCNd8", "SCNd16", "SCNd32", "SCNd64", "SCNdPTR",
+        "SCNu8", "SCNu16", "SCNu32", "SCNu64", "SCNuPTR",
+        "SCNx8", "SCNx16", "SCNx32", "SCNx64", "SCNxPTR",
+        // float.h
+        "FLT_MAX", "FLT_MIN", "DBL_MAX", "DBL_MIN", "LDBL_MAX", "LDBL_MIN",
+        "FLT_EPSILON", "DBL_EPSILON", "LDBL_EPSILON",
+    };
+
+    (void) userdata;
+
+    if (buf[0]==CMD_SIGN[0] && cursorPos==1) {
+        mlSetCompletionStart(comp, 1);
+        static char const cmds[] = "qhflpPmt;";
+        char s[2] = {0};
+        for (usz i = 0; i<sizeof(cmds)-1; ++i) {
+            s[0] = cmds[i];
+            mlAddCompletion(comp, s, s);
+        }
+        return;
+    }
+
+    int start;
+    for (start = cursorPos-1; start>=0; --start) {
+        char c = buf[start];
+        if (isalnum(c) || c=='_') { continue; }
+        break;
+    }
+    start += 1;
+    mlSetCompletionStart(comp, start);
+
+    int count = cursorPos - start;
+    if (count==0) return;
+
+    size_t mark = nob_temp_save();
+    #define FIND_IN_LIST(LIST, FMT) \
+        for (usz i = 0; i<sizeof(LIST)/sizeof(*LIST); ++i) { \
+            if (strncmp(buf+start, LIST[i], count)==0) { \
+                char *replacement = nob_temp_sprintf(FMT, LIST[i]); \
+                mlAddCompletion(comp, replacement, LIST[i]); \
+            } \
+        }
+    if (TrimPrefixSv(nob_sv_from_cstr(buf), CPP_SIGN)) {
+        FIND_IN_LIST(cpp, "%s ")
+    } else {
+        FIND_IN_LIST(keywords, "%s ")
+        FIND_IN_LIST(stmtLike, "%s;")
+        FIND_IN_LIST(typeLike, "%s ")
+        FIND_IN_LIST(funcLike, "%s(")
+        FIND_IN_LIST(constLike, "%s")
+    }
+    nob_temp_rewind(mark);
+}
+
+void HighlightFunc(char const *buf, mlHighlights *hl, void *userdata)
+{
+    static char const *const cKeywords[] = {
+        "if", "else", 
+        "for", "do", "while",
+        "switch", "case", "default", 
+        "return", "goto", "auto",
+        "break", "continue",
+        "struct", "union", "enum", "const", "volatile", "static",
+        "extern", "register", "inline", "restrict",
+    };
+
+    static char const *const cTypes[] = {
+        "int", "char", "float", "double", "void", "short", "long", "signed",
+        "unsigned", "bool",
+        // known types
+        "size_t", "ssize_t", "wchar_t",
+        "int8_t", "int16_t", "int32_t", "int64_t",
+        "uint8_t", "uint16_t", "uint32_t", "uint64_t",
+        // stdint.h
+        "intmax_t", "intptr_t", "uintmax_t", "uintptr_t",
+    };
+
+    (void) userdata;
+
+    size_t len = strlen(buf);
+    int strStoreCap = (int)(1+len);
+    char *strStore = (char *)malloc(strStoreCap);
+
+    stb_lexer lexer = {0};
+    stb_c_lexer_init(&lexer, buf, buf+len, strStore, strStoreCap);
+    while (stb_c_lexer_get_token(&lexer)) {
+        switch (lexer.token) {
+        default:
+        break; case CLEX_parse_error:
+            goto endloop;
+        break; case CLEX_id:
+            for (usz i = 0; i<sizeof(cKeywords)/sizeof(*cKeywords); ++i) {
+                if (strcmp(lexer.string, cKeywords[i])==0) {
+                    mlAddHighlight(hl, 1, mlColor_Magenta,
+                        lexer.where_firstchar-buf, 1+lexer.where_lastchar-lexer.where_firstchar);
+                    goto outloop;
+                }
+            }
+            for (usz i = 0; i<sizeof(cTypes)/sizeof(*cTypes); ++i) {
+                if (strcmp(lexer.string, cTypes[i])==0) {
+                    mlAddHighlight(hl, 1, mlColor_Blue,
+                        lexer.where_firstchar-buf, 1+lexer.where_lastchar-lexer.where_firstchar);
+                    goto outloop;
+                }
+            }
+        break; case CLEX_dqstring: case CLEX_charlit:
+            mlAddHighlight(hl, 0, mlColor_BrightYellow,
+                lexer.where_firstchar-buf, 1+lexer.where_lastchar-lexer.where_firstchar);
+        break; case CLEX_intlit: case CLEX_floatlit:
+            mlAddHighlight(hl, 0, mlColor_BrightGreen,
+                lexer.where_firstchar-buf, 1+lexer.where_lastchar-lexer.where_firstchar);
+        }
+    outloop:;
+    }
+endloop:
+    free(strStore);
+}
+bool SbContains(StrBuilder *sb, StrBuilder *part)
+{
+    if (part->count==0) return true;
+    for (usz i = 0; i+part->count<=sb->count; ++i) {
+        if (memcmp(sb->items+i, part->items, part->count)==0) return true;
+    }
+    return false;
+}
+
+// run everything collected since the last flush in one compilation
+bool Flush(Session *ss)
+{
+    StrBuilder empty = {0};
+    if (!ss->pending) return true;
+    // a single cell fails the same way in both modes
+    ss->holdErrors = ss->cells.count>1;
+    int r = Run(ss, ss->runLine, &empty, &empty);
+    ss->holdErrors = false;
+    ss->heldErrors.count = 0;
+    if (!ss->ranMain && ss->cells.count>1) {
+        // nothing ran: like the repl, each cell on top of the ones that compiled
+        StrBuilder pre = {0}, src = {0};
+        nob_sb_append_buf(&pre, ss->pre.items, ss->pre.count);
+        nob_sb_append_buf(&src, ss->src.items, ss->src.count);
+        ss->pre.count = ss->cells.items[0].preCount;
+        ss->src.count = ss->cells.items[0].srcCount;
+        for (usz k = 0; k<ss->cells.count; ++k) {
+            struct BatchCell *c = &ss->cells.items[k], *next = k+1<ss->cells.count? c+1: NULL;
+            usz preEnd = next!=NULL? next->preCount: pre.count;
+            usz srcEnd = next!=NULL? next->srcCount: src.count;
+            usz preCount = ss->pre.count, srcCount = ss->src.count;
+            nob_sb_append_buf(&ss->pre, pre.items+c->preCount, preEnd-c->preCount);
+            nob_sb_append_buf(&ss->src, src.items+c->srcCount, srcEnd-c->srcCount);
+            int rc = Run(ss, c->line, &empty, &empty);
+            if (!ss->ranMain) {
+                ss->pre.count = preCount;
+                ss->src.count = srcCount;
+                ss->failed = true;
+            } else {
+                ss->status = rc;
+            }
+        }
+        nob_sb_free(pre);
+        nob_sb_free(src);
+    } else if (!ss->ranMain && ss->cells.count==1) {
+        // dropped like a failed line of the repl, later cells don't repeat its errors
+        ss->pre.count = ss->cells.items[0].preCount;
+        ss->src.count = ss->cells.items[0].srcCount;
+        ss->failed = true;
+    } else if (r<0) {
+        ss->failed = true;
+    } else {
+        ss->status = r;
+    }
+    ss->runLine = ss->line;
+    ss->pending = false;
+    ss->cells.count = 0;
+    ss->framePointers = false;
+    return true;
+}
+
+// one-off cell (;p, ;t, ...) kept in the script so that it runs in order
+void BatchAppendCell(Session *ss)
+{
+    if (!SbContains(&ss->pre, &ss->first)) {
+        nob_sb_append_buf(&ss->pre, ss->first.items, ss->first.count);
+    }
+    AppendLineNum(&ss->src, 1+ss->line);
+    nob_sb_append_cstr(&ss->src, "ONCE {\n");
+    nob_sb_append_buf(&ss->src, ss->last.items, ss->last.count);
+    nob_sb_append_cstr(&ss->src, "}\n");
+}
+
+// sessions and the journal are streams of "name length\nbytes\n" records
+
+char const *journalPath = NULL;
+FILE *journalFile = NULL;
+
+void AppendRecord(StrBuilder *sb, char const *name, char const *data, usz len)
+{
+    nob_sb_appendf(sb, "%s %zu\n", name, len);
+    nob_sb_append_buf(sb, data, len);
+    nob_da_append(sb, '\n');
+}
+
+void AppendRecordNum(StrBuilder *sb, char const *name, usz num)
+{
+    size_t mark = nob_temp_save();
+    char const *s = nob_temp_sprintf("%zu", num);
+    AppendRecord(sb, name, s, strlen(s));
+    nob_temp_rewind(mark);
+}
+
+void AppendSettings(Session *ss, StrBuilder *sb)
+{
+    AppendRecordNum(sb, "rt", ss->rt);
+    AppendRecordNum(sb, "werror", ss->werror);
+    if (ss->compiler!=NULL) {
+        AppendRecord(sb, "compiler", ss->compiler, strlen(ss->compiler));
+    }
+    AppendRecord(sb, "optclear", "", 0);
+    for (usz i = 0; i<ss->opt.count; ++i) {
+        AppendRecord(sb, "opt", ss->opt.items[i], strlen(ss->opt.items[i]));
+    }
+    AppendRecord(sb, "argclear", "", 0);
+    for (usz i = 0; i<ss->arg.count; ++i) {
+        AppendRecord(sb, "arg", ss->arg.items[i], strlen(ss->arg.items[i]));
+    }
+}
+
+void AppendSnapshot(Session *ss, StrBuilder *sb)
+{
+    AppendRecord(sb, "clear", "", 0);
+    AppendSettings(ss, sb);
+    AppendRecord(sb, "pre", ss->pre.items, ss->pre.count);
+    AppendRecord(sb, "src", ss->src.items, ss->src.count);
+    AppendRecordNum(sb, "line", ss->line);
+}
+
+bool RecordIs(Nob_String_View name, char const *cstr)
+{
+    return nob_sv_eq(name, nob_sv_from_cstr(cstr));
+}
+
+// a truncated record at the end (crash while writing) is ignored
+// returns the compiled module key if the records have one
+// chops the next record off sv, false at the end or at a truncated one
+bool NextRecord(Nob_String_View *sv, Nob_String_View *name, Nob_String_View *val)
+{
+    if (sv->count==0) return false;
+    Nob_String_View head = nob_sv_chop_by_delim(sv, '\n');
+    *name = nob_sv_chop_by_delim(&head, ' ');
+    usz len = 0;
+    if (head.count==0) return false;
+    for (usz i = 0; i<head.count && isdigit((unsigned char)head.data[i]); ++i) {
+        len = len*10 + (usz)(head.data[i]-'0');
+    }
+    if (len+1>sv->count) return false;
+    *val = nob_sv_from_parts(sv->data, len);
+    sv->data += len+1;
+    sv->count -= len+1;
+    return true;
+}
+
+uint64_t ApplyRecords(Session *ss, Nob_String_View sv)
+{
+    uint64_t key = 0;
+    Nob_String_View name, val;
+    while (NextRecord(&sv, &name, &val)) {
+        // code is copied as is, short values are kept as strings
+        char *cstr = NULL;
+        if (!RecordIs(name, "pre") && !RecordIs(name, "src")) {
+            cstr = nob_temp_strndup(val.data, val.count);
+        }
+
+        if (RecordIs(name, "clear")) {
+            ss->pre.count = 0;
+            ss->src.count = 0;
+            ss->line = 0;
+            ss->runLine = 0;
+        } else if (RecordIs(name, "pre")) {
+            nob_sb_append_buf(&ss->pre, val.data, val.count);
+        } else if (RecordIs(name, "src")) {
+            nob_sb_append_buf(&ss->src, val.data, val.count);
+        } else if (RecordIs(name, "line")) {
+            ss->line = (usz)strtoull(cstr, NULL, 10);
+            ss->runLine = ss->line;
+        } else if (RecordIs(name, "rt")) {
+            ss->rt = (RunType)atoi(cstr);
+        } else if (RecordIs(name, "werror")) {
+            ss->werror = atoi(cstr)!=0;
+        } else if (RecordIs(name, "compiler")) {
+            ss->compiler = cstr;
+            ss->compilerType = COMPILER_UNDECIDED;
+        } else if (RecordIs(name, "optclear")) {
+            ss->opt.count = 0;
+        } else if (RecordIs(name, "opt")) {
+            nob_da_append(&ss->opt, cstr);
+        } else if (RecordIs(name, "argclear")) {
+            ss->arg.count = 0;
+        } else if (RecordIs(name, "arg")) {
+            nob_da_append(&ss->arg, cstr);
+        } else if (RecordIs(name, "key")) {
+            key = strtoull(cstr, NULL, 16);
+        }
+    }
+    return key;
+}
+
+// temp
+char const *HostName(void)
+{
+    char name[256] = {0};
+#ifdef _WIN32
+    DWORD n = sizeof(name);
+    if (!GetComputerNameA(name, &n)) name[0] = '\0';
+#else
+    if (gethostname(name, sizeof(name)-1)!=0) name[0] = '\0';
+#endif
+    return nob_temp_strdup(name);
+}
+
+// temp, "" if unknown
+char const *CpuModel(void)
+{
+    char line[512];
+    char const *model = "";
+#ifdef __linux__
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    while (f!=NULL && fgets(line, sizeof(line), f)!=NULL) {
+        Nob_String_View sv = nob_sv_from_cstr(line);
+        Nob_String_View key = nob_sv_trim(nob_sv_chop_by_delim(&sv, ':'));
+        if (RecordIs(key, "model name") || RecordIs(key, "Model")) {
+            model = nob_temp_sv_to_cstr(nob_sv_trim(sv));
+            break;
+        }
+    }
+    if (f!=NULL) fclose(f);
+#else
+    (void)line;
+#endif
+    return model;
+}
+
+// temp, compiler path and the first line of its banner
+char const *CompilerIdentity(Session *ss)
+{
+    if (ss->rt!=RT_CC) return "tcc";
+    Nob_String_View sv = nob_sv_from_parts(ss->compilerIdent.items, ss->compilerIdent.count);
+    Nob_String_View path = nob_sv_chop_by_delim(&sv, '\n');
+    Nob_String_View banner = nob_sv_trim(nob_sv_chop_by_delim(&sv, '\n'));
+    return nob_temp_sprintf(SV_Fmt" ("SV_Fmt")", SV_Arg(path), SV_Arg(banner));
+}
+
+// results of --save, as session records
+struct Baseline {
+    Nob_String_View host, cpu, compiler, opt, conditions;
+    long long time;
+    usz count;
+    struct {
+        Nob_String_View label;
+        uint64_t reps;
+        struct {
+            double *items;
+            usz count;
+            usz capacity;
+        } samples;
+    } variants[IC_BENCH_MAX];
+    double perRep[IC_PERF_MAX];
+    uint32_t counted;
+};
+
+void AppendBaseline(Session *ss, StrBuilder *sb)
+{
+    struct Bench *b = &ss->bench;
+    StrBuilder opt = {0}, samples = {0};
+    for (usz i = 0; i<ss->opt.count; ++i) {
+        nob_sb_appendf(&opt, "%s%s", i>0? " ": "", ss->opt.items[i]);
+    }
+    char const *host = HostName(), *cpu = CpuModel(), *compiler = CompilerIdentity(ss);
+    AppendRecordNum(sb, "ic", 1);
+    AppendRecord(sb, "host", host, strlen(host));
+    AppendRecord(sb, "cpu", cpu, strlen(cpu));
+    AppendRecord(sb, "compiler", compiler, strlen(compiler));
+    AppendRecord(sb, "opt", opt.items, opt.count);
+    AppendRecord(sb, "conditions", ss->quiet.conditions, strlen(ss->quiet.conditions));
+    AppendRecordNum(sb, "time", (usz)time(NULL));
+    for (usz v = 0; v<b->count; ++v) {
+        AppendRecord(sb, "variant", b->variants[v].label, strlen(b->variants[v].label));
+        AppendRecordNum(sb, "reps", b->variants[v].reps);
+        samples.count = 0;
+        for (usz i = 0; i<b->variants[v].samples.count; ++i) {
+            nob_sb_appendf(&samples, "%s%.17g", i>0? " ": "", b->variants[v].samples.items[i]);
+        }
+        AppendRecord(sb, "samples", samples.items, samples.count);
+    }
+    for (usz i = 0; i<IC_PERF_MAX; ++i) {
+        if (!(ss->perf.counted & 1u<<i)) continue;
+        char const *counter = nob_temp_sprintf("%s %.17g", perfEventNames[i], ss->perf.perRep[i]);
+        AppendRecord(sb, "counter", counter, strlen(counter));
+    }
+    nob_sb_free(opt);
+    nob_sb_free(samples);
+}
+
+// the values point into sv
+void ParseBaseline(Nob_String_View sv, struct Baseline *bl)
+{
+    Nob_String_View name, val;
+    memset(bl, 0, sizeof(*bl));
+    size_t mark = nob_temp_save();
+    while (NextRecord(&sv, &name, &val)) {
+        if (RecordIs(name, "host")) bl->host = val;
+        else if (RecordIs(name, "cpu")) bl->cpu = val;
+        else if (RecordIs(name, "compiler")) bl->compiler = val;
+        else if (RecordIs(name, "opt")) bl->opt = val;
+        else if (RecordIs(name, "conditions")) bl->conditions = val;
+        else if (RecordIs(name, "time")) bl->time = atoll(nob_temp_sv_to_cstr(val));
+        else if (RecordIs(name, "variant") && bl->count<IC_BENCH_MAX) bl->variants[bl->count++].label = val;
+        else if (RecordIs(name, "reps") && bl->count>0) {
+            bl->variants[bl->count-1].reps = strtoull(nob_temp_sv_to_cstr(val), NULL, 10);
+        } else if (RecordIs(name, "samples") && bl->count>0) {
+            char const *p = nob_temp_sv_to_cstr(val);
+            char *end;
+            for (double x = strtod(p, &end); end!=p; x = strtod(p, &end)) {
+                nob_da_append(&bl->variants[bl->count-1].samples, x);
+                p = end;
+            }
+        } else if (RecordIs(name, "counter")) {
+            Nob_String_View event = nob_sv_chop_by_delim(&val, ' ');
+            for (usz i = 0; i<IC_PERF_MAX; ++i) {
+                if (!RecordIs(event, perfEventNames[i])) continue;
+                bl->perRep[i] = strtod(nob_temp_sv_to_cstr(val), NULL);
+                bl->counted |= 1u<<i;
+            }
+        }
+    }
+    nob_temp_rewind(mark);
+}
+
+// differences of the setup are printed, they may explain the numbers
+void CompareSetup(char const *what, Nob_String_View then, char const *now)
+{
+    if (nob_sv_eq(then, nob_sv_from_cstr(now))) return;
+    printf("  %s was \""SV_Fmt"\", is \"%s\"\n", what, SV_Arg(then), now);
+}
+
+// returns the number of regressions
+usz BenchCompare(Session *ss, char const *name, struct Baseline *bl)
+{
+    struct Bench *b = &ss->bench;
+    usz regressions = 0;
+    StrBuilder opt = {0};
+    for (usz i = 0; i<ss->opt.count; ++i) {
+        nob_sb_appendf(&opt, "%s%s", i>0? " ": "", ss->opt.items[i]);
+    }
+    nob_sb_append_null(&opt);
+    time_t then = (time_t)bl->time;
+    char date[64] = "";
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M", localtime(&then));
+    printf("compared with \"%s\" of %s\n", name, date);
+    CompareSetup("host", bl->host, HostName());
+    CompareSetup("cpu", bl->cpu, CpuModel());
+    CompareSetup("compiler", bl->compiler, CompilerIdentity(ss));
+    CompareSetup("options", bl->opt, opt.items);
+    CompareSetup("conditions", bl->conditions, ss->quiet.conditions);
+    FILE *f = TraceFile();
+    for (usz v = 0; v<b->count; ++v) {
+        struct BenchVariant *cur = &b->variants[v];
+        usz k = 0;
+        while (k<bl->count && !nob_sv_eq(bl->variants[k].label, nob_sv_from_cstr(cur->label))) ++k;
+        if (k==bl->count || bl->variants[k].samples.count==0 || cur->samples.count==0) {
+            printf("  %-12s not in the baseline\n", cur->label[0]!='\0'? cur->label: "time");
+            continue;
+        }
+        struct SampleStats was, is;
+        double *old = bl->variants[k].samples.items;
+        usz oldCount = bl->variants[k].samples.count;
+        double p = MannWhitneyP(old, oldCount, cur->samples.items, cur->samples.count);
+        SampleStatsOf(old, oldCount, &was);
+        SampleStatsOf(cur->samples.items, cur->samples.count, &is);
+        double ratio = was.median>0? is.median/was.median: 1;
+        // significant and large enough to matter
+        char const *verdict = p>=0.05 || fabs(ratio-1)<0.02? "same": ratio>1? "regression": "improvement";
+        printf("  %-12s %10s -> %-10s", cur->label[0]!='\0'? cur->label: "time", FormatNs(was.median), FormatNs(is.median));
+        if (verdict[0]=='s') {
+            printf("  no significant change (p=%.2g)\n", p);
+        } else {
+            printf("  %.3gx %s (p=%.2g), %s\n", ratio>=1? ratio: 1/ratio, ratio>1? "slower": "faster", p,
+                verdict[0]=='r'? "REGRESSION": "improvement");
+        }
+        if (verdict[0]=='r') regressions += 1;
+        if (f!=NULL && !traceChrome) {
+            fprintf(f, "{\"compare\":\"%s\",\"bench\":\"%s\",\"baseline_median_ns\":%.17g,\"median_ns\":%.17g,"
+                "\"ratio\":%.17g,\"p\":%.17g,\"verdict\":\"%s\"}\n", name, cur->label, was.median, is.median, ratio, p, verdict);
+        }
+    }
+    for (usz i = 0; i<IC_PERF_MAX; ++i) {
+        if (!(bl->counted & ss->perf.counted & 1u<<i) || bl->perRep[i]==0) continue;
+        printf("  %-22s %12.4g -> %-12.4g %+.1f%%\n", perfEventNames[i], bl->perRep[i], ss->perf.perRep[i],
+            100*(ss->perf.perRep[i]/bl->perRep[i]-1));
+    }
+    if (f!=NULL) fflush(f);
+    nob_sb_free(opt);
+    return regressions;
+}
+
+// --compare with and --save to dataDir/bench/name.txt after a report
+void BenchStore(Session *ss)
+{
+    struct TimeOptions *to = &ss->bench.opts;
+    if (to->save[0]=='\0' && to->compare[0]=='\0') return;
+    if (dataDir==NULL) {
+        printf("no data directory for --save and --compare\n");
+        return;
+    }
+    size_t mark = nob_temp_save();
+    StrBuilder sb = {0};
+    if (to->compare[0]!='\0') {
+        char const *path = nob_temp_sprintf("%s/bench/%s.txt", dataDir, to->compare);
+        struct Baseline bl;
+        Nob_Log_Level old = nob_minimal_log_level;
+        nob_minimal_log_level = NOB_NO_LOGS;
+        bool found = nob_read_entire_file(path, &sb);
+        nob_minimal_log_level = old;
+        if (found) {
+            ParseBaseline(nob_sv_from_parts(sb.items, sb.count), &bl);
+            // a script fails on regressions, e.g. in ci
+            if (BenchCompare(ss, to->compare, &bl)>0 && ss->batch) ss->failed = true;
+            for (usz v = 0; v<bl.count; ++v) nob_da_free(bl.variants[v].samples);
+        } else {
+            printf("no baseline \"%s\" in %s/bench\n", to->compare, dataDir);
+        }
+    }
+    if (to->save[0]!='\0') {
+        char const *dir = nob_temp_sprintf("%s/bench", dataDir);
+        char const *path = nob_temp_sprintf("%s/%s.txt", dir, to->save);
+        sb.count = 0;
+        AppendBaseline(ss, &sb);
+        if (nob_mkdir_if_not_exists(dir) && nob_write_entire_file(path, sb.items, sb.count)) {
+            printf("saved as \"%s\" to %s\n", to->save, path);
+        }
+    }
+    fflush(stdout);
+    nob_sb_free(sb);
+    nob_temp_rewind(mark);
+}
+
+// append-only log of accepted input, flushed on every record
+void JournalWrite(StrBuilder *sb)
+{
+    if (journalFile==NULL) return;
+    fwrite(sb->items, 1, sb->count, journalFile);
+    fflush(journalFile);
+}
+
+void JournalCode(Session *ss, char const *name, StrBuilder *code)
+{
+    StrBuilder sb = {0};
+    if (journalFile==NULL) return;
+    AppendRecord(&sb, name, code->items, code->count);
+    AppendRecordNum(&sb, "line", ss->line);
+    JournalWrite(&sb);
+    nob_sb_free(sb);
+}
+
+void JournalSettings(Session *ss)
+{
+    StrBuilder sb = {0};
+    if (journalFile==NULL) return;
+    AppendSettings(ss, &sb);
+    JournalWrite(&sb);
+    nob_sb_free(sb);
+}
+
+void JournalSnapshot(Session *ss)
+{
+    StrBuilder sb = {0};
+    if (journalFile==NULL) return;
+    AppendSnapshot(ss, &sb);
+    JournalWrite(&sb);
+    nob_sb_free(sb);
+}
+
+// not inside a temp mark, the path lives on the temporary storage
+void OpenJournal(Session *ss)
+{
+    char const *dir = nob_temp_sprintf("%s/journal", dataDir);
+    if (!nob_mkdir_if_not_exists(dir)) return;
+    journalPath = nob_temp_sprintf("%s/%d.txt", dir, GetPid());
+    journalFile = fopen(journalPath, "wb");
+    JournalSnapshot(ss);
+}
+
+// a clean exit leaves nothing to recover
+void CloseJournal(void)
+{
+    if (journalFile==NULL) return;
+    fclose(journalFile);
+    journalFile = NULL;
+    nob_delete_file(journalPath);
+}
+
+// newest journal of an instance that did not exit cleanly
+bool ResumeJournal(Session *ss)
+{
+    Nob_File_Paths names = {0};
+    char const *best = NULL;
+    time_t bestTime = 0;
+    bool ok = false;
+    char const *dir = nob_temp_sprintf("%s/journal", dataDir);
+    if (!nob_read_entire_dir(dir, &names)) goto end;
+    for (usz i = 0; i<names.count; ++i) {
+        char const *name = names.items[i];
+        char *endp;
+        long pid = strtol(name, &endp, 10);
+        if (endp==name || strcmp(endp, ".txt")!=0) continue;
+        if (pid==GetPid() || IsProcessAlive((int)pid)) continue;
+        char const *path = nob_temp_sprintf("%s/%s", dir, name);
+        struct stat st;
+        if (stat(path, &st)!=0 || (best!=NULL && st.st_mtime<bestTime)) continue;
+        best = path;
+        bestTime = st.st_mtime;
+    }
+    if (best==NULL) {
+        printf("no journal to resume\n");
+        goto end;
+    }
+
+    StrBuilder content = {0};
+    if (nob_read_entire_file(best, &content)) {
+        ApplyRecords(ss, nob_sv_from_parts(content.items, content.count));
+        printf("resumed %zu lines from %s\n", ss->line, best);
+        // the new journal starts with a snapshot, the old one is done
+        nob_delete_file(best);
+        ok = true;
+    }
+    nob_sb_free(content);
+end:
+    nob_da_free(names);
+    return ok;
+}
+
+// temp
+char *SessionFilePath(char const *name, char const *ext)
+{
+    return nob_temp_sprintf("%s/sessions/%s%s", dataDir, name, ext);
+}
+
+// the compiled module goes along so that restoring skips the compiler
+void SaveSession(Session *ss, char const *name)
+{
+    StrBuilder empty = {0}, sb = {0};
+    // outside of the mark, the paths live on the temporary storage
+    SetupDataPaths();
+    size_t mark = nob_temp_save();
+    if (!nob_mkdir_if_not_exists(nob_temp_sprintf("%s/sessions", dataDir))) goto end;
+    char const *path = SessionFilePath(name, ".txt");
+    char const *modPath = SessionFilePath(name, dllExt);
+
+    AppendRecordNum(&sb, "ic", 1);
+    AppendSnapshot(ss, &sb);
+#ifdef IC_CACHE
+    // the unit that the Run of ;restore looks up, compiled but not run;
+    // the loaded one was built with the last cell and another LASTLINE
+    if (ss->rt!=RT_MEM && SessionEnsureWorkDir(ss) && ss->cacheDir!=NULL) {
+        bool ranMain = ss->ranMain;
+        ss->buildOnly = true;
+        Run(ss, ss->line, &empty, &empty);
+        ss->buildOnly = false;
+        ss->ranMain = ranMain;
+        char const *cached = ss->builtKey!=0? CacheLookup(ss->cacheDir, ss->builtKey): NULL;
+        if (cached!=NULL && nob_copy_file(cached, modPath)) {
+            AppendRecord(&sb, "key", nob_temp_sprintf("%016"PRIx64, ss->builtKey), 16);
+        }
+    }
+#endif
+    if (nob_write_entire_file(path, sb.items, sb.count)) {
+        printf("saved session \"%s\" to %s\n", name, path);
+    }
+end:
+    nob_sb_free(sb);
+    nob_temp_rewind(mark);
+}
+
+void RestoreSession(Session *ss, char const *name)
+{
+    StrBuilder empty = {0}, content = {0};
+    SetupDataPaths();
+    size_t mark = nob_temp_save();
+    char const *path = SessionFilePath(name, ".txt");
+    if (!nob_read_entire_file(path, &content)) goto end;
+
+    // the records live on the temporary storage like the other options
+    nob_temp_rewind(mark);
+    uint64_t key = ApplyRecords(ss, nob_sv_from_parts(content.items, content.count));
+    mark = nob_temp_save();
+#ifdef IC_CACHE
+    char const *modPath = SessionFilePath(name, dllExt);
+    if (key!=0 && ss->rt!=RT_MEM && SessionEnsureWorkDir(ss) && ss->cacheDir!=NULL
+            && CacheLookup(ss->cacheDir, key)==NULL && nob_file_exists(modPath)==1) {
+        CacheStore(ss->cacheDir, key, modPath);
+    }
+#else
+    (void)key;
+#endif
+    JournalSnapshot(ss);
+    printf("restored session \"%s\" (%zu lines)\n", name, ss->line);
+    // check that it still builds, e.g. headers may have moved
+    Run(ss, ss->line, &empty, &empty);
+end:
+    nob_sb_free(content);
+    nob_temp_rewind(mark);
+}
+
+bool ExportSession(Session *ss, char const *path, enum TuKind kind)
+{
+    StrBuilder empty = {0}, sb = {0};
+    size_t mark = nob_temp_save();
+    bool ok = PrepareCString(ss->line, &ss->pre, &empty, &ss->src, &empty, &sb, kind)
+        && nob_write_entire_file(path, sb.items, sb.count);
+    nob_sb_free(sb);
+    nob_temp_rewind(mark);
+    return ok;
+}
+
+// out [options...], a shared library if out ends with the dll extension
+void BuildSession(Session *ss, Nob_String_View args)
+{
+    Nob_Cmd parsed = {0}, cc = {0};
+    size_t mark = nob_temp_save();
+    ParseShell(args.data, args.count, &parsed);
+    if (parsed.count==0 || parsed.items[0][0]=='\0') {
+        printf("Usage: "CMD_SIGN"build out [compiler options...]\n");
+        goto end;
+    }
+    char const *out = parsed.items[0];
+    bool lib = nob_sv_end_with(nob_sv_from_cstr(out), dllExt);
+    if (!SessionEnsureWorkDir(ss)) goto end;
+    if (ss->compilerType==COMPILER_UNDECIDED) SetCompilerType(ss);
+    char const *srcPath = nob_temp_sprintf("%s/_build.c", ss->workDir);
+    if (!ExportSession(ss, srcPath, lib? TU_LIBRARY: TU_PROGRAM)) goto end;
+
+    nob_da_append(&cc, GetCompiler(ss));
+    CompilerSetup(ss, &cc);
+    for (usz i = 0; i<ss->opt.count; ++i) {
+        nob_da_append(&cc, ss->opt.items[i]);
+    }
+    if (parsed.count==1) {
+        nob_da_append(&cc, ss->compilerType==CL_EXE? "/O2": "-O2");
+    }
+    for (usz i = 1; i<parsed.count; ++i) {
+        nob_da_append(&cc, parsed.items[i]);
+    }
+    nob_cc_inputs(&cc, srcPath);
+    nob_da_append(&cc, nob_temp_sprintf("-I%s", ss->nobDir)); // for nob.h
+    if (ss->compilerType==CL_EXE) {
+        if (lib) nob_da_append(&cc, "/LD");
+        nob_cmd_append(&cc,
+            nob_temp_sprintf("/Fo:%s/_build.obj", ss->workDir),
+            nob_temp_sprintf("/Fe:%s", out));
+    } else {
+        if (lib) nob_cmd_append(&cc, "-shared", "-fPIC");
+        nob_cmd_append(&cc, "-o", out);
+    #ifndef _WIN32
+        nob_da_append(&cc, "-lm");
+    #endif
+    }
+    if (TranslateCompile(ss, &cc)) printf("built %s\n", out);
+end:
+    nob_da_free(parsed);
+    nob_da_free(cc);
+    nob_temp_rewind(mark);
+}
+
+// ;watch: rerun a cell whenever one of the files is saved
+
+struct WatchFile {
+    char const *path;
+    char const *name;
+    struct stat st;
+};
+
+bool WatchStatChanged(struct WatchFile *w)
+{
+    struct stat st;
+    if (stat(w->path, &st)!=0) return false;
+    bool changed = st.st_mtime!=w->st.st_mtime || st.st_size!=w->st.st_size;
+    w->st = st;
+    return changed;
+}
+
+// waits up to ms for a line on stdin, true if one was read
+bool WatchStdin(int ms)
+{
+#ifdef _WIN32
+    for (int t = 0; t<ms; t += 10) {
+        if (_kbhit()) {
+            char buf[256];
+            if (fgets(buf, sizeof(buf), stdin)==NULL) {}
+            return true;
+        }
+        Sleep(10);
+    }
+    return false;
+#else
+    struct pollfd pfd = { .fd = 0, .events = POLLIN };
+    if (poll(&pfd, 1, ms)<=0) return false;
+    char buf[256];
+    if (read(0, buf, sizeof(buf))<0) return false;
+    return true;
+#endif
+}
+
+// blocks until enter is pressed
+void Watch(Session *ss, Nob_String_View args)
+{
+    Nob_Cmd paths = {0};
+    struct {
+        struct WatchFile *items;
+        usz count;
+        usz capacity;
+    } files = {0};
+    StrBuilder cellFirst = {0}, cellLast = {0};
+    size_t mark = nob_temp_save();
+    int ifd = -1;
+
+    ParseShell(args.data, args.count, &paths);
+    if (paths.count==0 || paths.items[0][0]=='\0') {
+        printf("Usage: "CMD_SIGN"watch file...\n");
+        goto end;
+    }
+    if (!mlIsATTY()) {
+        printf("%s\n", "watch needs an interactive terminal");
+        goto end;
+    }
+#ifdef __linux__
+    ifd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+#endif
+    for (usz i = 0; i<paths.count; ++i) {
+        struct WatchFile w = { .path = paths.items[i] };
+        if (stat(w.path, &w.st)!=0) {
+            printf("cannot watch %s: %s\n", w.path, strerror(errno));
+            goto end;
+        }
+        char const *slash = strrchr(w.path, '/');
+    #ifdef _WIN32
+        char const *bslash = strrchr(w.path, '\\');
+        if (bslash>slash) slash = bslash;
+    #endif
+        w.name = slash!=NULL? slash+1: w.path;
+    #ifdef __linux__
+        // editors often save by renaming, so watch the directory
+        if (ifd>=0) {
+            char const *dir = slash!=NULL? nob_temp_strndup(w.path, slash-w.path+1): ".";
+            inotify_add_watch(ifd, dir, IN_CLOSE_WRITE|IN_MOVED_TO|IN_CREATE);
+        }
+    #endif
+        nob_da_append(&files, w);
+    }
+
+    // the cell entered last is the one rerun
+    nob_sb_append_buf(&cellFirst, ss->first.items, ss->first.count);
+    nob_sb_append_buf(&cellLast, ss->last.items, ss->last.count);
+    printf("watching %zu file(s)%s, press enter to stop\n", files.count,
+        ifd>=0? "": " (polling)");
+
+    while (!WatchStdin(ifd>=0? 50: 200)) {
+        bool changed = false;
+    #ifdef __linux__
+        if (ifd>=0) {
+            char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+            ssize_t n;
+            while ((n = read(ifd, buf, sizeof(buf)))>0) {
+                for (char *p = buf; p<buf+n; ) {
+                    struct inotify_event *ev = (struct inotify_event *)p;
+                    for (usz i = 0; ev->len>0 && i<files.count; ++i) {
+                        if (strcmp(ev->name, files.items[i].name)==0) changed = true;
+                    }
+                    p += sizeof(*ev)+ev->len;
+                }
+            }
+            // let the editor finish writing
+            if (changed) {
+                WatchStdin(30);
+                while (read(ifd, buf, sizeof(buf))>0) {}
+            }
+            for (usz i = 0; changed && i<files.count; ++i) WatchStatChanged(&files.items[i]);
+        } else
+    #endif
+        for (usz i = 0; i<files.count; ++i) {
+            if (WatchStatChanged(&files.items[i])) changed = true;
+        }
+        if (!changed) continue;
+
+        uint64_t start = nob_nanos_since_unspecified_epoch();
+        int r = Run(ss, ss->line, &cellFirst, &cellLast);
+        uint64_t ns = nob_nanos_since_unspecified_epoch() - start;
+        printf("[%s in %.1f ms]\n", r>=0? "rerun": "failed", ns/1e6);
+        fflush(stdout);
+    }
+
+end:
+    if (ifd>=0) close(ifd);
+    nob_da_free(paths);
+    nob_da_free(files);
+    nob_sb_free(cellFirst);
+    nob_sb_free(cellLast);
+    nob_temp_rewind(mark);
+}
+
+// ;replay-profile: time spent in each recorded cell of the replay
+
+int ProfLineCmp(void const *a, void const *b)
+{
+    struct ProfLine const *x = a, *y = b;
+    return (x->ns < y->ns) - (x->ns > y->ns);
+}
+
+// first line of the cell starting at line
+Nob_String_View CellSnippet(StrBuilder *src, usz line)
+{
+    Nob_String_View sv = nob_sv_from_parts(src->items, src->count);
+    bool found = false;
+    while (sv.count>0) {
+        Nob_String_View l = nob_sv_chop_by_delim(&sv, '\n');
+        if (IsCppOf(l, "line")) {
+            char const *p = l.data;
+            while (p<l.data+l.count && !isdigit((unsigned char)*p)) ++p;
+            found = (usz)strtoull(p, NULL, 10)==line;
+            continue;
+        }
+        if (found) return nob_sv_trim(l);
+    }
+    return nob_sv_from_cstr("");
+}
+
+void ReplayProfile(Session *ss, Nob_String_View args)
+{
+    StrBuilder instr = {0}, first = {0}, last = {0};
+    Nob_Cmd lines = {0};
+    size_t mark = nob_temp_save();
+    if (nob_sv_eq(args, nob_sv_from_cstr("reset"))) {
+        ss->prof.count = 0;
+        ss->profRuns = 0;
+        printf("replay profile cleared\n");
+        goto end;
+    }
+    int runs = args.count>0? atoi(nob_temp_sv_to_cstr(args)): 1;
+    if (runs<1) runs = 1;
+
+    // a probe before every cell, the time up to the next probe is the cell's
+    Nob_String_View sv = nob_sv_from_parts(ss->src.items, ss->src.count);
+    while (sv.count>0) {
+        Nob_String_View l = nob_sv_chop_by_delim(&sv, '\n');
+        if (IsCppOf(l, "line")) {
+            char const *p = l.data;
+            while (p<l.data+l.count && !isdigit((unsigned char)*p)) ++p;
+            nob_sb_appendf(&instr, "__icProbe(%zu);\n", lines.count);
+            nob_da_append(&lines, p);
+        }
+        nob_sb_append_buf(&instr, l.data, l.count);
+        nob_da_append(&instr, '\n');
+    }
+    if (lines.count==0) {
+        printf("nothing recorded to profile\n");
+        goto end;
+    }
+
+#ifdef _WIN32
+    nob_sb_append_cstr(&first, "#include <windows.h>\n");
+    nob_sb_append_cstr(&first,
+        "static uint64_t __icProfNow(void) {"
+        "LARGE_INTEGER f, t; QueryPerformanceFrequency(&f); QueryPerformanceCounter(&t);"
+        "return (uint64_t)(1e9 * t.QuadPart / f.QuadPart);}\n");
+    nob_sb_append_cstr(&first, "__declspec(dllexport) ");
+#else
+    nob_sb_append_cstr(&first, "#include <time.h>\n");
+    nob_sb_append_cstr(&first,
+        "static uint64_t __icProfNow(void) {"
+        "struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t);"
+        "return (uint64_t)t.tv_sec*1000000000u + t.tv_nsec;}\n");
+#endif
+    nob_sb_appendf(&first, "uint64_t __icProfNs[%zu], __icProfCalls[%zu];\n",
+        lines.count, lines.count);
+    nob_sb_appendf(&first,
+        "static uint64_t __icProfT; static int __icProfK = -1;\n"
+        "static void __icProbe(int k) {"
+        "uint64_t now = __icProfNow();"
+        "if (__icProfK>=0) __icProfNs[__icProfK] += now - __icProfT;"
+        "if (k<%zu) __icProfCalls[k] += 1;"
+        "__icProfK = k<%zu? k: -1; __icProfT = __icProfNow();}\n",
+        lines.count, lines.count);
+    nob_sb_appendf(&last, "__icProbe(%zu);\n", lines.count);
+
+    StrBuilder saved = ss->src;
+    ss->src = instr;
+    int done = 0;
+    for (; done<runs; ++done) {
+        Run(ss, ss->line, &first, &last);
+        if (!ss->ranMain) break;
+        uint64_t *ns = SessionSymbol(ss, "__icProfNs");
+        uint64_t *calls = SessionSymbol(ss, "__icProfCalls");
+        if (ns==NULL || calls==NULL) break;
+        for (usz k = 0; k<lines.count; ++k) {
+            usz line = (usz)strtoull(lines.items[k], NULL, 10);
+            usz j;
+            for (j = 0; j<ss->prof.count && ss->prof.items[j].line!=line; ++j) {}
+            if (j==ss->prof.count) {
+                struct ProfLine pl = { .line = line };
+                nob_da_append(&ss->prof, pl);
+            }
+            ss->prof.items[j].ns += ns[k];
+            ss->prof.items[j].calls += calls[k];
+        }
+        ss->profRuns += 1;
+    }
+    instr = ss->src;
+    ss->src = saved;
+    if (done==0) goto end;
+
+    uint64_t total = 0;
+    for (usz j = 0; j<ss->prof.count; ++j) total += ss->prof.items[j].ns;
+    qsort(ss->prof.items, ss->prof.count, sizeof(*ss->prof.items), ProfLineCmp);
+    printf("replay profile: %zu replays, %s per replay\n",
+        ss->profRuns, FormatNs((double)total/ss->profRuns));
+    printf("%6s %10s %10s %7s %6s  %s\n", "line", "total", "avg", "calls", "share", "code");
+    for (usz j = 0; j<ss->prof.count; ++j) {
+        struct ProfLine *pl = &ss->prof.items[j];
+        Nob_String_View code = CellSnippet(&ss->src, pl->line);
+        printf("%6zu %10s %10s %7"PRIu64" %5.1f%%  %.*s%s\n",
+            pl->line, FormatNs((double)pl->ns),
+            FormatNs(pl->calls? (double)pl->ns/pl->calls: 0.0), pl->calls,
+            total? 100.0*pl->ns/total: 0.0,
+            (int)(code.count>40? 40: code.count), code.data, code.count>40? "...": "");
+    }
+    for (usz j = 0; j<ss->prof.count && j<3; ++j) {
+        struct ProfLine *pl = &ss->prof.items[j];
+        if (total==0 || pl->ns*5<total) break;
+        printf("line %zu takes %.0f%% of every replay: wrap it in ONCE if later lines do not "
+            "need its effects, otherwise cache its result (e.g. in a file)\n",
+            pl->line, 100.0*pl->ns/total);
+    }
+
+end:
+    nob_sb_free(instr);
+    nob_sb_free(first);
+    nob_sb_free(last);
+    nob_da_free(lines);
+    nob_temp_rewind(mark);
+}
+
+// ;stats: where the time of the last evaluations went
+
+void Stats(Session *ss, Nob_String_View args)
+{
+    size_t mark = nob_temp_save();
+    if (nob_sv_eq(args, nob_sv_from_cstr("reset"))) {
+        ss->statsCount = 0;
+        printf("stats cleared\n");
+        return;
+    }
+    usz n = args.count>0? (usz)atoi(nob_temp_sv_to_cstr(args)): 10;
+    usz kept = ss->statsCount<IC_STATS_MAX? ss->statsCount: IC_STATS_MAX;
+    if (n<1) n = 1;
+    if (n>kept) n = kept;
+    if (n==0) {
+        printf("no evaluations yet\n");
+        goto end;
+    }
+    struct EvalStats *last[IC_STATS_MAX];
+    for (usz i = 0; i<n; ++i) {
+        last[i] = &ss->stats[(ss->statsCount-n+i)%IC_STATS_MAX];
+    }
+
+    printf("%5s %-3s %-4s %8s %8s", "eval", "rt", "ok", "src", "rss");
+    for (int p = 0; p<PH_COUNT; ++p) printf(" %9s", phaseNames[p]);
+    printf(" %9s\n", "total");
+    for (usz i = 0; i<n; ++i) {
+        struct EvalStats *st = last[i];
+        printf("%5zu %-3s %-4s %7zuk %7zuM", st->eval, runTypeNames[st->rt],
+            !st->ok? "fail": st->cached? "hit": "yes", (st->srcBytes+1023)/1024, st->rssKb/1024);
+        for (int p = 0; p<PH_COUNT; ++p) printf(" %9s", FormatNs((double)st->ns[p]));
+        printf(" %9s\n", FormatNs((double)st->total));
+    }
+
+    double values[IC_STATS_MAX];
+    double ps[] = {0.5, 0.9, 0.99, 1.0};
+    char const *psNames[] = {"p50", "p90", "p99", "max"};
+    for (usz k = 0; k<NOB_ARRAY_LEN(ps); ++k) {
+        printf("%5s %-3s %-4s %8s %8s", psNames[k], "", "", "", "");
+        for (int p = 0; p<=PH_COUNT; ++p) {
+            for (usz i = 0; i<n; ++i) values[i] = (double)(p<PH_COUNT? last[i]->ns[p]: last[i]->total);
+            qsort(values, n, sizeof(*values), DoubleCmp);
+            printf(" %9s", FormatNs(PercentileOf(values, n, ps[k])));
+        }
+        printf("\n");
+    }
+end:
+    nob_temp_rewind(mark);
+}
+
+// ;word [arg], arg is trimmed and may be empty
+bool CmdWord(StrBuilder *out, char const *word, Nob_String_View *arg)
+{
+    Nob_String_View sv = nob_sv_from_parts(out->items+1, out->count-1);
+    usz n = strlen(word);
+    if (sv.count<n || memcmp(sv.data, word, n)!=0) return false;
+    if (sv.count>n && !isspace((unsigned char)sv.data[n])) return false;
+    *arg = nob_sv_trim(nob_sv_from_parts(sv.data+n, sv.count-n));
+    return true;
+}
+
+bool historyLoaded = false;
+
+void ExitFunc(void)
+{
+    if (historyLoaded) mlHistorySave(mlHistoryDefault, hisPath);
+    CloseJournal();
+    CleanupWorkspace();
+}
+
+// returns false when the session should end
+bool Step(Session *ss)
+{
+    bool ok;
+    usz outLine = ss->line;
+    enum InputKind kind = GetInput(&ss->out, &outLine, false, false);
+    enum InputKind kind2;
+    struct TimeOptions timeOptions;
+    StrBuilder *out = &ss->out, *first = &ss->first, *last = &ss->last;
+
+    if (ss->batch) {
+        if (kind==InputEnd) {
+            Flush(ss);
+            return false;
+        }
+        // code cells are collected, everything else sees the code before it
+        Nob_String_View arg;
+        if (kind==Shell || (kind==Cmd && strchr("pPmtf", out->items[1])==NULL)
+            || (kind==Cmd && CmdWord(out, "fixtures", &arg))) {
+            if (!Flush(ss)) return false;
+        }
+    }
+
+    if (kind==Empty) {
+        if (ss->batch) ss->line = outLine;
+        return true;
+    } else if (kind==InputEnd) {
+        return false;
+    } else if (kind==Shell) {
+        SpawnShell(out->items+1, out->count-1);
+    } else if (kind==Cmd) {
+        Nob_String_View word;
+        size_t mark = nob_temp_save();
+        if (CmdWord(out, "save", &word)) {
+            if (IsValidSessionName(word)) SaveSession(ss, nob_temp_sv_to_cstr(word));
+            else printf("Usage: "CMD_SIGN"save name\n");
+            nob_temp_rewind(mark);
+        } else if (CmdWord(out, "restore", &word)) {
+            if (IsValidSessionName(word)) RestoreSession(ss, nob_temp_sv_to_cstr(word));
+            else printf("Usage: "CMD_SIGN"restore name\n");
+            // the script goes on after the restored lines, LASTLINE keeps
+            // the restored output from being printed again
+            if (ss->batch && ss->line>outLine) outLine = ss->line;
+        } else if (CmdWord(out, "export", &word)) {
+            if (word.count==0) printf("Usage: "CMD_SIGN"export out.c\n");
+            else if (ExportSession(ss, nob_temp_sv_to_cstr(word), TU_PROGRAM)) {
+                printf("exported to %.*s\n", (int)word.count, word.data);
+            }
+            nob_temp_rewind(mark);
+        } else if (CmdWord(out, "build", &word)) {
+            BuildSession(ss, word);
+        } else if (CmdWord(out, "watch", &word)) {
+            Watch(ss, word);
+        } else if (CmdWord(out, "replay-profile", &word)) {
+            ReplayProfile(ss, word);
+        } else if (CmdWord(out, "stats", &word)) {
+            Stats(ss, word);
+        } else if (CmdWord(out, "sweep", &word)) {
+            if (ReadSweep(ss, word, &outLine)) goto run_label;
+        } else if (CmdWord(out, "quiet", &word)) {
+            SetQuiet(ss, word);
+        } else if (CmdWord(out, "fixtures", &word)) {
+            Fixtures(ss, word);
+        } else if (CmdWord(out, "prof", &word)) {
+            if (ReadProf(ss, word, &outLine)) goto run_label;
+        } else if (CmdWord(out, "bench", &word)) {
+            if (ReadBench(ss, word, &outLine)) goto run_label;
+        } else switch (out->items[1]) {
+        default:
+            if (isspace(out->items[1])) {
+                Help();
+                break;
+            }
+            printf("Unknown command \"%.*s\"\n", (int)out->count-1, out->items);
+        break; case 'h':
+            Help();
+        break; case 'q':
+            return false;
+        break; case 'l':
+            printf("/* top */\n");
+            printf("%.*s", (int)ss->pre.count, ss->pre.items);
+            printf("/* main */\n");
+            printf("%.*s", (int)ss->src.count, ss->src.items);
+        break; case 'c':
+            ss->pre.count = 0;
+            ss->src.count = 0;
+            ss->line = 0;
+            ss->runLine = 0;
+            ss->pending = false;
+            ss->cells.count = 0;
+            ss->prof.count = 0;
+            ss->profRuns = 0;
+            JournalSnapshot(ss);
+            return true;
+        break; case 'A':
+            ss->arg.count = 0;
+            puts("cleared arguments");
+        break; case 'a':
+            if (out->count-1>2) {
+                ParseShell(out->items+2, out->count-2, &ss->arg);
+            }
+            printf("current arguments:");
+            for (usz i = 0; i<ss->arg.count; ++i) {
+                printf(" '%s'", ss->arg.items[i]);
+            }
+            puts("");
+        break; case 'O':
+            ss->opt.count = 0;
+            puts("cleared options");
+        break; case 'o':
+            if (out->count-1>2) {
+                ParseShell(out->items+2, out->count-2, &ss->opt);
+            }
+            printf("current options:");
+            for (usz i = 0; i<ss->opt.count; ++i) {
+                printf(" '%s'", ss->opt.items[i]);
+            }
+            puts("");
+        break; case 'p':
+            if (out->count-1>2) {
+                first->count = 0;
+                last->count = 0;
+                AppendLineNum(last, 1+ss->line);
+                nob_sb_append_cstr(last, "__printmem(&(");
+                nob_sb_append_buf(last, out->items+2, out->count-3);
+                nob_sb_append_cstr(last, "),sizeof(");
+                nob_sb_append_buf(last, out->items+2, out->count-3);
+                nob_sb_append_cstr(last, "));\n");
+                goto run_label;
+            }
+        break; case 'P':
+            if (out->count-1>2) {
+                first->count = 0;
+                last->count = 0;
+                AppendLineNum(last, 1+ss->line);
+                nob_sb_append_cstr(last, "__printmem(");
+                nob_sb_append_buf(last, out->items+2, out->count-3);
+                nob_sb_append_cstr(last, ");\n");
+                goto run_label;
+            }
+        break; case 't':
+            if (out->items[2]=='m') {
+                // `;tm:config, ...`, the list is parsed like reps
+                StrBuilder none = {0};
+                if (!ParseTimeOptions(nob_sv_from_parts(out->items+3, out->count-3), &timeOptions, &ss->temp)) break;
+                if (timeOptions.threadsCount>0) {
+                    printf("\""CMD_SIGN"tm\" does not take threads\n");
+                    break;
+                }
+                if (timeOptions.save[0]!='\0' || timeOptions.compare[0]!='\0') {
+                    printf("\""CMD_SIGN"tm\" does not take --save or --compare\n");
+                    break;
+                }
+                if (ss->batch && !Flush(ss)) return false;
+                timeOptions.once = true;
+                timeOptions.bench = true;
+                if (ss->batch) ss->line = outLine;
+                outLine = ss->line;
+                kind2 = GetInput(out, &outLine, false, true);
+                if (kind2==Expr) {
+                    SinkExpr(out);
+                } else if (kind2!=Stmt) {
+                    printf("Expected statement or expression after \""CMD_SIGN"tm\"\n");
+                    break;
+                }
+                AppendTiming(first, last, ss->line, &timeOptions, &none, out);
+                TimingMatrix(ss, nob_sv_from_parts(ss->temp.items, ss->temp.count), first, last);
+                if (ss->batch) ss->line = outLine;
+                break;
+            }
+            // `;t` times once, `;t:reps` multiple
+            if (!ParseTimeOptions(nob_sv_from_parts(out->items+2, out->count-2), &timeOptions, &ss->temp)) break;
+            if (timeOptions.threadsCount>0 && (timeOptions.perfEvents!=0 || timeOptions.rusage
+                    || timeOptions.save[0]!='\0' || timeOptions.compare[0]!='\0')) {
+                printf("\""CMD_SIGN"t@\" does not take --perf, --rusage, --save or --compare\n");
+                break;
+            }
+            // the results store, outside of the temp marks of Run
+            if (timeOptions.save[0]!='\0' || timeOptions.compare[0]!='\0') SetupDataPaths();
+            if (ss->batch) ss->line = outLine;
+            outLine = ss->line;
+            kind2 = GetInput(out, &outLine, false, true);
+            if (kind2==Expr) {
+                SinkExpr(out);
+            } else if (kind2!=Stmt) {
+                printf("Expected statement or expression after \""CMD_SIGN"t\"\n");
+                break;
+            }
+            AppendTiming(first, last, ss->line, &timeOptions, &ss->temp, out);
+            goto run_label;
+        break; case 'f':
+            if (ss->batch) ss->line = outLine;
+            outLine = ss->line;
+            kind2 = GetInput(out, &outLine, true, false);
+            if (kind2==Stmt || kind2==Expr) { // functions are recognized as expressions for now...
+                kind = Pre;
+                goto prep_label;
+            } else {
+                printf("Expected statement after \""CMD_SIGN"f\"\n");
+                break;
+            }
+        break; case 'm':
+            if (out->count-1>2) {
+                first->count = 0;
+                last->count = 0;
+                AppendLineNum(last, 1+ss->line);
+                nob_sb_append_cstr(last, "printf(\"%s\\n\", __IC_STRINGIFY(");
+                nob_sb_append_buf(last, out->items+2, out->count-3);
+                nob_sb_append_cstr(last, "));\n");
+                goto run_label;
+            }
+        break; case ';':
+            // reload last
+            if (ss->batch) break;
+            goto run_label;
+        break; case 'r':
+            switch (out->items[2]) {
+            default:
+            break; case 'c': ss->rt = RT_CC;
+                ss->compilerType = COMPILER_UNDECIDED; // reset compiler type
+                if (out->items[3]=='=') {
+                    if (out->items[4]=='\n') {
+                        ss->compiler = NULL;
+                    } else {
+                        Nob_String_View sv = nob_sv_trim(
+                            nob_sv_from_parts(out->items+4, out->count-4));
+                        ss->tempCc.count = 0;
+                        nob_sb_append_buf(&ss->tempCc, sv.data, sv.count);
+                        nob_sb_append_null(&ss->tempCc);
+                        ss->compiler = ss->tempCc.items;
+                    }
+                }
+            break; case 'd': ss->rt = RT_DLL;
+            break; case 'm': ss->rt = RT_MEM;
+            }
+            printf("run type: %s, ",
+                ss->rt==RT_CC? "cc":
+                ss->rt==RT_DLL? "dll":
+                "mem");
+            printf("compiler: %s\n",
+                ss->rt==RT_CC? GetCompiler(ss):
+                "tcc");
+        break; case 'w':
+            ss->werror = true;
+            printf("warnings as errors: on\n");
+        break; case 'W':
+            ss->werror = false;
+            printf("warnings as errors: off\n");
+        }
+        if (strchr("AaOorwW", out->items[1])!=NULL) JournalSettings(ss);
+    } else {
+    prep_label:
+        last->count = 0;
+        if (kind==Stmt) {
+            AppendLineNum(last, 1+ss->line);
+            nob_sb_append_buf(last, out->items, out->count);
+        } else if (kind==Expr) {
+            AppendLineNum(last, 1+ss->line);
+            nob_sb_append_cstr(last, "PRINT((");
+            nob_sb_append_buf(last, out->items, out->count-1);
+            nob_sb_append_cstr(last, "));\n");
+        }
+
+        first->count = 0;
+        if (kind==Pre) {
+            AppendLineNum(first, 1+ss->line);
+            nob_sb_append_buf(first, out->items, out->count);
+        }
+    run_label:
+        if (ss->batch) {
+            struct BatchCell cell = { ss->pre.count, ss->src.count, ss->line };
+            nob_da_append(&ss->cells, cell);
+            if (kind==Stmt || kind==Expr) {
+                // PRINT already runs only once
+                nob_sb_append_buf(&ss->src, last->items, last->count);
+            } else if (kind==Pre) {
+                nob_sb_append_buf(&ss->pre, first->items, first->count);
+            } else {
+                BatchAppendCell(ss);
+            }
+            ss->line = outLine;
+            ss->pending = true;
+            return true;
+        }
+        ok = Run(ss, ss->line, first, last) >= 0;
+        ss->framePointers = false;
+        if (ok) {
+            if (kind==Stmt) {
+                ss->line = outLine;
+                nob_sb_append_buf(&ss->src, last->items, last->count);
+                JournalCode(ss, "src", last);
+            } else if (kind==Pre) {
+                ss->line = outLine;
+                nob_sb_append_buf(&ss->pre, first->items, first->count);
+                JournalCode(ss, "pre", first);
+            }
+        }
+    }
+    if (ss->batch) ss->line = outLine;
+    return true;
+}
+
+bool IsShebangFile(char const *path)
+{
+    char magic[2] = {0};
+    FILE *f = fopen(path, "rb");
+    if (f==NULL) return false;
+    usz n = fread(magic, 1, 2, f);
+    fclose(f);
+    return n==2 && magic[0]=='#' && magic[1]=='!';
+}
+
+void AppendCode(StrBuilder *sb, usz *line, char const *code)
+{
+    AppendLineNum(sb, 1+*line);
+    for (char const *p = code; *p; ++p) {
+        if (*p=='\n') *line += 1;
+    }
+    nob_sb_append_cstr(sb, code);
+    if (sb->count==0 || sb->items[sb->count-1]!='\n') {
+        nob_da_append(sb, '\n');
+        *line += 1;
+    }
+}
+
+// add top level code, the session is unchanged if it does not compile
+bool SessionDefine(Session *ss, char const *code)
+{
+    StrBuilder empty = {0};
+    usz preCount = ss->pre.count, line = ss->line;
+    AppendCode(&ss->pre, &ss->line, code);
+    Run(ss, ss->line, &empty, &empty);
+    if (!ss->ranMain) {
+        ss->pre.count = preCount;
+        ss->line = line;
+        return false;
+    }
+    return true;
+}
+
+// server mode, one forked worker per connection and one session per worker,
+// every evaluation runs in a fork of the worker so that it can be interrupted
+
+#ifndef _WIN32
+char const *servePath = NULL;
+int serveFd = -1;
+bool serveClosed = false;
+StrBuilder serveIn = {0};
+volatile sig_atomic_t serveStop = 0;
+
+// raw value of key in a flat json object
+bool JsonField(Nob_String_View obj, char const *key, Nob_String_View *val)
+{
+    usz keyLen = strlen(key);
+    usz i = 0, n = obj.count;
+    char const *s = obj.data;
+    #define JSON_WS() while (i<n && isspace((unsigned char)s[i])) ++i
+    JSON_WS();
+    if (i>=n || s[i]!='{') return false;
+    ++i;
+    for (;;) {
+        JSON_WS();
+        if (i>=n || s[i]!='"') return false;
+        usz k = ++i;
+        while (i<n && s[i]!='"') i += s[i]=='\\'? 2: 1;
+        if (i>=n) return false;
+        bool match = i-k==keyLen && memcmp(s+k, key, keyLen)==0;
+        ++i;
+        JSON_WS();
+        if (i>=n || s[i]!=':') return false;
+        ++i;
+        JSON_WS();
+        usz v = i;
+        int depth = 0;
+        for (; i<n; ++i) {
+            char c = s[i];
+            if (c=='"') {
+                for (++i; i<n && s[i]!='"'; ++i) if (s[i]=='\\') ++i;
+            } else if (c=='{' || c=='[') {
+                depth += 1;
+            } else if (c=='}' || c==']') {
+                if (depth==0) break;
+                depth -= 1;
+            } else if (c==',' && depth==0) {
+                break;
+            }
+        }
+        if (i>=n) return false;
+        if (match) {
+            *val = nob_sv_trim(nob_sv_from_parts(s+v, i-v));
+            return true;
+        }
+        if (s[i]=='}') return false;
+        ++i;
+    }
+    #undef JSON_WS
+}
+
+bool JsonString(Nob_String_View val, StrBuilder *out)
+{
+    if (val.count<2 || val.data[0]!='"' || val.data[val.count-1]!='"') return false;
+    for (usz i = 1; i+1<val.count; ++i) {
+        char c = val.data[i];
+        if (c!='\\') {
+            nob_da_append(out, c);
+            continue;
+        }
+        if (++i+1>=val.count) return false;
+        switch (val.data[i]) {
+        default: nob_da_append(out, val.data[i]);
+        break; case 'n': nob_da_append(out, '\n');
+        break; case 't': nob_da_append(out, '\t');
+        break; case 'r': nob_da_append(out, '\r');
+        break; case 'b': nob_da_append(out, '\b');
+        break; case 'f': nob_da_append(out, '\f');
+        break; case 'u': {
+            if (i+5>=val.count) return false;
+            char hex[5] = {0};
+            memcpy(hex, val.data+i+1, 4);
+            unsigned cp = (unsigned)strtoul(hex, NULL, 16);
+            i += 4;
+            // surrogate pair
+            if (cp>=0xD800 && cp<0xDC00 && i+7<val.count && val.data[i+1]=='\\') {
+                memcpy(hex, val.data+i+3, 4);
+                unsigned lo = (unsigned)strtoul(hex, NULL, 16);
+                cp = 0x10000 + ((cp-0xD800)<<10) + (lo-0xDC00);
+                i += 6;
+            }
+            if (cp<0x80) {
+                nob_da_append(out, (char)cp);
+            } else if (cp<0x800) {
+                nob_da_append(out, (char)(0xC0|cp>>6));
+                nob_da_append(out, (char)(0x80|(cp&0x3F)));
+            } else if (cp<0x10000) {
+                nob_da_append(out, (char)(0xE0|cp>>12));
+                nob_da_append(out, (char)(0x80|((cp>>6)&0x3F)));
+                nob_da_append(out, (char)(0x80|(cp&0x3F)));
+            } else {
+                nob_da_append(out, (char)(0xF0|cp>>18));
+                nob_da_append(out, (char)(0x80|((cp>>12)&0x3F)));
+                nob_da_append(out, (char)(0x80|((cp>>6)&0x3F)));
+                nob_da_append(out, (char)(0x80|(cp&0x3F)));
+            }
+        }
+        }
+    }
+    return true;
+}
+
+void JsonAppendString(StrBuilder *sb, char const *s, usz n)
+{
+    nob_da_append(sb, '"');
+    for (usz i = 0; i<n; ++i) {
+        unsigned char c = s[i];
+        switch (c) {
+        default:
+            if (c<0x20) nob_sb_appendf(sb, "\\u%04x", c);
+            else nob_da_append(sb, (char)c);
+        break; case '"': nob_sb_append_cstr(sb, "\\\"");
+        break; case '\\': nob_sb_append_cstr(sb, "\\\\");
+        break; case '\n': nob_sb_append_cstr(sb, "\\n");
+        break; case '\t': nob_sb_append_cstr(sb, "\\t");
+        break; case '\r': nob_sb_append_cstr(sb, "\\r");
+        }
+    }
+    nob_da_append(sb, '"');
+}
+
+void ServeSend(StrBuilder *sb)
+{
+    nob_da_append(sb, '\n');
+    usz off = 0;
+    while (off<sb->count) {
+        ssize_t n = write(serveFd, sb->items+off, sb->count-off);
+        if (n<0 && errno==EINTR) continue;
+        if (n<=0) { serveClosed = true; return; }
+        off += (usz)n;
+    }
+}
+
+// starts a response with the id of the request
+void ServeBegin(StrBuilder *sb, Nob_String_View req, bool ok)
+{
+    Nob_String_View id;
+    sb->count = 0;
+    nob_sb_append_cstr(sb, "{\"id\":");
+    if (JsonField(req, "id", &id)) nob_sb_append_buf(sb, id.data, id.count);
+    else nob_sb_append_cstr(sb, "null");
+    nob_sb_appendf(sb, ",\"ok\":%s", ok? "true": "false");
+}
+
+void ServeError(Nob_String_View req, char const *msg)
+{
+    StrBuilder sb = {0};
+    ServeBegin(&sb, req, false);
+    nob_sb_append_cstr(&sb, ",\"error\":");
+    JsonAppendString(&sb, msg, strlen(msg));
+    nob_da_append(&sb, '}');
+    ServeSend(&sb);
+    nob_sb_free(sb);
+}
+
+bool ServeIsOp(Nob_String_View req, char const *op)
+{
+    Nob_String_View val;
+    if (!JsonField(req, "op", &val)) return false;
+    return val.count==strlen(op)+2 && memcmp(val.data+1, op, val.count-2)==0;
+}
+
+// false on end of connection
+bool ServeReadMore(void)
+{
+    char buf[4096];
+    ssize_t n;
+    do n = read(serveFd, buf, sizeof(buf)); while (n<0 && errno==EINTR);
+    if (n<=0) {
+        serveClosed = true;
+        return false;
+    }
+    nob_sb_append_buf(&serveIn, buf, (usz)n);
+    return true;
+}
+
+// answers interrupt requests queued while code runs, leaves the others
+bool ServeTakeInterrupt(void)
+{
+    bool found = false;
+    usz w = 0, i = 0;
+    while (i<serveIn.count) {
+        char *nl = memchr(serveIn.items+i, '\n', serveIn.count-i);
+        usz end = nl==NULL? serveIn.count: (usz)(nl-serveIn.items)+1;
+        Nob_String_View req = nob_sv_from_parts(serveIn.items+i, end-i);
+        if (nl!=NULL && ServeIsOp(req, "interrupt")) {
+            StrBuilder sb = {0};
+            ServeBegin(&sb, req, true);
+            nob_sb_append_cstr(&sb, ",\"interrupted\":true}");
+            ServeSend(&sb);
+            nob_sb_free(sb);
+            found = true;
+        } else {
+            memmove(serveIn.items+w, serveIn.items+i, end-i);
+            w += end-i;
+        }
+        i = end;
+    }
+    serveIn.count = w;
+    return found;
+}
 
-    (void) userdata;
+struct ServeResult {
+    int r;
+    bool ranMain;
+};
 
-    if (buf[0]==CMD_SIGN[0] && cursorPos==1) {
-        mlSetCompletionStart(comp, 1);
-        static char const cmds[] = "qhflpPmt;";
-        char s[2] = {0};
-        for (usz i = 0; i<sizeof(cmds)-1; ++i) {
-            s[0] = cmds[i];
-            mlAddCompletion(comp, s, s);
+// Run in a child process, the worker keeps listening for interrupts
+int ServeRun(Session *ss, usz line, StrBuilder *first, StrBuilder *last)
+{
+    struct ServeResult res = { -1, false };
+    int fds[2];
+    if (ss->rt!=RT_MEM && !SessionEnsureWorkDir(ss)) return -1;
+    // decided once per worker, not once per child
+    if (ss->rt==RT_CC && ss->compilerType==COMPILER_UNDECIDED) SetCompilerType(ss);
+    if (pipe(fds)!=0) return -1;
+    // programs started by the code don't hold the result pipe open
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid<0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid==0) {
+        close(fds[0]);
+        // exit() in the code runs ExitFunc, the workspace is the worker's
+        workDir = NULL;
+        journalFile = NULL;
+        ss->runHook = NULL;
+        res.r = Run(ss, line, first, last);
+        res.ranMain = ss->ranMain;
+        fflush(stdout);
+        fflush(stderr);
+        if (write(fds[1], &res, sizeof(res))!=(ssize_t)sizeof(res)) {}
+        _exit(0);
+    }
+    close(fds[1]);
+
+    // the result pipe becomes readable with the result or when the child dies
+    bool interrupted = false;
+    for (;;) {
+        struct pollfd pfd[2] = {
+            { .fd = fds[0], .events = POLLIN },
+            { .fd = interrupted || serveClosed? -1: serveFd, .events = POLLIN },
+        };
+        if (poll(pfd, 2, -1)<0) {
+            if (errno==EINTR) continue;
+            break;
+        }
+        if (pfd[0].revents!=0) break;
+        if (pfd[1].revents!=0 && (!ServeReadMore() || ServeTakeInterrupt())) {
+            kill(pid, SIGKILL);
+            interrupted = true;
         }
-        return;
     }
+    ssize_t n;
+    do n = read(fds[0], &res, sizeof(res)); while (n<0 && errno==EINTR);
+    int status = 0;
+    while (waitpid(pid, &status, 0)<0 && errno==EINTR) {}
+    if (n!=(ssize_t)sizeof(res)) {
+        res.r = -1;
+        res.ranMain = false;
+        if (interrupted) fprintf(stderr, "interrupted\n");
+        else if (WIFSIGNALED(status)) fprintf(stderr, "killed by signal %d\n", WTERMSIG(status));
+    }
+    close(fds[0]);
 
-    int start;
-    for (start = cursorPos-1; start>=0; --start) {
-        char c = buf[start];
-        if (isalnum(c) || c=='_') { continue; }
-        break;
+    // the child used the next output path
+    if (ss->rt!=RT_MEM) {
+        NextOutPath(ss);
+        RemoveOutPath(ss->rawOutPath.items);
     }
-    start += 1;
-    mlSetCompletionStart(comp, start);
+    ss->runCount += 1;
+    if (!res.ranMain) ss->errorCount += 1;
+    ss->ranMain = res.ranMain;
+    return res.r;
+}
 
-    int count = cursorPos - start;
-    if (count==0) return;
+// stdout and stderr of a request, including those of the code it runs
+typedef struct ServeCapture {
+    int savedOut, savedErr;
+    char const *outPath, *errPath;
+} ServeCapture;
+
+// false with nothing redirected if a file or descriptor can't be had
+bool ServeCaptureBegin(Session *ss, ServeCapture *cap)
+{
+    fflush(stdout);
+    fflush(stderr);
+    cap->outPath = nob_temp_sprintf("%s/_serve_out.txt", ss->workDir);
+    cap->errPath = nob_temp_sprintf("%s/_serve_err.txt", ss->workDir);
+    cap->savedOut = dup(1);
+    cap->savedErr = dup(2);
+    int o = open(cap->outPath, O_WRONLY|O_CREAT|O_TRUNC, 0600);
+    int e = open(cap->errPath, O_WRONLY|O_CREAT|O_TRUNC, 0600);
+    bool ok = cap->savedOut>=0 && cap->savedErr>=0 && o>=0 && e>=0;
+    if (ok && dup2(o, 1)<0) ok = false;
+    if (ok && dup2(e, 2)<0) {
+        dup2(cap->savedOut, 1);
+        ok = false;
+    }
+    if (o>=0) close(o);
+    if (e>=0) close(e);
+    if (!ok) {
+        if (cap->savedOut>=0) close(cap->savedOut);
+        if (cap->savedErr>=0) close(cap->savedErr);
+    }
+    return ok;
+}
+
+void ServeCaptureEnd(ServeCapture *cap, StrBuilder *sb)
+{
+    StrBuilder text = {0};
+    fflush(stdout);
+    fflush(stderr);
+    dup2(cap->savedOut, 1);
+    dup2(cap->savedErr, 2);
+    close(cap->savedOut);
+    close(cap->savedErr);
+    nob_read_entire_file(cap->outPath, &text);
+    nob_sb_append_cstr(sb, ",\"out\":");
+    JsonAppendString(sb, text.items, text.count);
+    text.count = 0;
+    nob_read_entire_file(cap->errPath, &text);
+    nob_sb_append_cstr(sb, ",\"err\":");
+    JsonAppendString(sb, text.items, text.count);
+    nob_sb_free(text);
+}
 
+void ServeRequest(Session *ss, Nob_String_View req)
+{
+    StrBuilder sb = {0}, code = {0};
+    Nob_String_View val;
     size_t mark = nob_temp_save();
-    #define FIND_IN_LIST(LIST, FMT) \
-        for (usz i = 0; i<sizeof(LIST)/sizeof(*LIST); ++i) { \
-            if (strncmp(buf+start, LIST[i], count)==0) { \
-                char *replacement = nob_temp_sprintf(FMT, LIST[i]); \
-                mlAddCompletion(comp, replacement, LIST[i]); \
-            } \
+
+    if (ServeIsOp(req, "eval") || ServeIsOp(req, "define")) {
+        if (!JsonField(req, "code", &val) || !JsonString(val, &code)) {
+            ServeError(req, "missing code");
+            goto end;
         }
-    if (TrimPrefixSv(nob_sv_from_cstr(buf), CPP_SIGN)) {
-        FIND_IN_LIST(cpp, "%s ")
+        usz errors = ss->errorCount;
+        uint64_t start = nob_nanos_since_unspecified_epoch();
+        ServeCapture cap;
+        if (!ServeCaptureBegin(ss, &cap)) {
+            ServeError(req, nob_temp_sprintf("could not capture output: %s", strerror(errno)));
+            goto end;
+        }
+        if (ServeIsOp(req, "define")) {
+            nob_sb_append_null(&code);
+            SessionDefine(ss, code.items);
+        } else {
+            // same as typing it in the repl
+            scriptText = nob_sv_from_parts(code.items, code.count);
+            useScriptText = true;
+            while (Step(ss)) {}
+            useScriptText = false;
+        }
+        ss->serveNanos += nob_nanos_since_unspecified_epoch() - start;
+        ss->requestCount += 1;
+        ServeBegin(&sb, req, ss->errorCount==errors);
+        ServeCaptureEnd(&cap, &sb);
+        nob_da_append(&sb, '}');
+        ServeSend(&sb);
+    } else if (ServeIsOp(req, "complete")) {
+        if (!JsonField(req, "code", &val) || !JsonString(val, &code)) {
+            ServeError(req, "missing code");
+            goto end;
+        }
+        nob_sb_append_null(&code);
+        int pos = (int)code.count-1;
+        if (JsonField(req, "pos", &val)) {
+            pos = atoi(nob_temp_sv_to_cstr(val));
+            if (pos<0 || pos>(int)code.count-1) pos = (int)code.count-1;
+        }
+        mlCompletions comp = {0};
+        CompleteFunc(code.items, pos, &comp, NULL);
+        ServeBegin(&sb, req, true);
+        nob_sb_appendf(&sb, ",\"start\":%d,\"items\":[", comp.start);
+        for (int i = 0; i<comp.len; ++i) {
+            if (i>0) nob_da_append(&sb, ',');
+            char const *r = comp.els[i].replacement;
+            JsonAppendString(&sb, r, strlen(r));
+        }
+        nob_sb_append_cstr(&sb, "]}");
+        ServeSend(&sb);
+        mlCompletionsClear(&comp);
+        free(comp.els);
+    } else if (ServeIsOp(req, "interrupt")) {
+        // nothing is running between requests
+        ServeBegin(&sb, req, true);
+        nob_sb_append_cstr(&sb, ",\"interrupted\":false}");
+        ServeSend(&sb);
+    } else if (ServeIsOp(req, "stats")) {
+        ServeBegin(&sb, req, true);
+        nob_sb_appendf(&sb,
+            ",\"pid\":%d,\"requests\":%zu,\"runs\":%zu,\"errors\":%zu,"
+            "\"lines\":%zu,\"busyMs\":%.3f}",
+            GetPid(), ss->requestCount, ss->runCount, ss->errorCount,
+            ss->line, ss->serveNanos/1e6);
+        ServeSend(&sb);
     } else {
-        FIND_IN_LIST(keywords, "%s ")
-        FIND_IN_LIST(stmtLike, "%s;")
-        FIND_IN_LIST(typeLike, "%s ")
-        FIND_IN_LIST(funcLike, "%s(")
-        FIND_IN_LIST(constLike, "%s")
+        ServeError(req, "unknown op");
     }
+
+end:
+    nob_sb_free(sb);
+    nob_sb_free(code);
     nob_temp_rewind(mark);
 }
 
-void HighlightFunc(char const *buf, mlHighlights *hl, void *userdata)
+void ServeConnection(Session *ss)
 {
-    static char const *const cKeywords[] = {
-        "if", "else", 
-        "for", "do", "while",
-        "switch", "case", "default", 
-        "return", "goto", "auto",
-        "break", "continue",
-        "struct", "union", "enum", "const", "volatile", "static",
-        "extern", "register", "inline", "restrict",
-    };
-
-    static char const *const cTypes[] = {
-        "int", "char", "float", "double", "void", "short", "long", "signed",
-        "unsigned", "bool",
-        // known types
-        "size_t", "ssize_t", "wchar_t",
-        "int8_t", "int16_t", "int32_t", "int64_t",
-        "uint8_t", "uint16_t", "uint32_t", "uint64_t",
-        // stdint.h
-        "intmax_t", "intptr_t", "uintmax_t", "uintptr_t",
-    };
+    // own workspace, the session template lives in the parent's
+    workDir = nob_temp_sprintf("%s/%d", tempDir, GetPid());
+    assert(nob_mkdir_if_not_exists(workDir));
+    ss->liveRawOutPath.count = 0;
+    ss->workDir = NULL;
+    SessionEnsureWorkDir(ss);
+    ss->runHook = ServeRun;
+
+    while (!serveClosed) {
+        char *nl = memchr(serveIn.items, '\n', serveIn.count);
+        if (nl==NULL) {
+            if (!ServeReadMore()) break;
+            continue;
+        }
+        usz len = (usz)(nl-serveIn.items)+1;
+        StrBuilder line = {0};
+        nob_sb_append_buf(&line, serveIn.items, len);
+        memmove(serveIn.items, serveIn.items+len, serveIn.count-len);
+        serveIn.count -= len;
+        Nob_String_View req = nob_sv_trim(nob_sv_from_parts(line.items, line.count));
+        if (req.count>0) ServeRequest(ss, req);
+        nob_sb_free(line);
+    }
+}
 
-    (void) userdata;
+void ServeSignal(int sig)
+{
+    (void)sig;
+    serveStop = 1;
+}
 
-    size_t len = strlen(buf);
-    int strStoreCap = (int)(1+len);
-    char *strStore = (char *)malloc(strStoreCap);
+int Serve(Session *ss, char const *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path)>=sizeof(addr.sun_path)) {
+        nob_log(NOB_ERROR, "socket path too long: %s", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
 
-    stb_lexer lexer = {0};
-    stb_c_lexer_init(&lexer, buf, buf+len, strStore, strStoreCap);
-    while (stb_c_lexer_get_token(&lexer)) {
-        switch (lexer.token) {
-        default:
-        break; case CLEX_parse_error:
-            goto endloop;
-        break; case CLEX_id:
-            for (usz i = 0; i<sizeof(cKeywords)/sizeof(*cKeywords); ++i) {
-                if (strcmp(lexer.string, cKeywords[i])==0) {
-                    mlAddHighlight(hl, 1, mlColor_Magenta,
-                        lexer.where_firstchar-buf, 1+lexer.where_lastchar-lexer.where_firstchar);
-                    goto outloop;
-                }
-            }
-            for (usz i = 0; i<sizeof(cTypes)/sizeof(*cTypes); ++i) {
-                if (strcmp(lexer.string, cTypes[i])==0) {
-                    mlAddHighlight(hl, 1, mlColor_Blue,
-                        lexer.where_firstchar-buf, 1+lexer.where_lastchar-lexer.where_firstchar);
-                    goto outloop;
-                }
-            }
-        break; case CLEX_dqstring: case CLEX_charlit:
-            mlAddHighlight(hl, 0, mlColor_BrightYellow,
-                lexer.where_firstchar-buf, 1+lexer.where_lastchar-lexer.where_firstchar);
-        break; case CLEX_intlit: case CLEX_floatlit:
-            mlAddHighlight(hl, 0, mlColor_BrightGreen,
-                lexer.where_firstchar-buf, 1+lexer.where_lastchar-lexer.where_firstchar);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd<0) {
+        nob_log(NOB_ERROR, "socket: %s", strerror(errno));
+        return 1;
+    }
+    // a stale socket of a dead server is replaced, a live one is not
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))==0) {
+        nob_log(NOB_ERROR, "%s is already being served", path);
+        close(fd);
+        return 1;
+    }
+    struct stat st;
+    if (stat(path, &st)==0 && S_ISSOCK(st.st_mode)) unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr))!=0 || listen(fd, 64)!=0) {
+        nob_log(NOB_ERROR, "could not listen on %s: %s", path, strerror(errno));
+        close(fd);
+        return 1;
+    }
+    servePath = path;
+
+    // warm state shared with the workers: compiler detection, the first
+    // compilation of the prolog (and its cache entry), loaded libraries
+    StrBuilder empty = {0};
+    if (ss->rt!=RT_MEM) SessionEnsureWorkDir(ss);
+    if (ss->rt==RT_CC) SetCompilerType(ss);
+    Run(ss, 0, &empty, &empty);
+
+    struct sigaction sa = { .sa_handler = ServeSignal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    nob_log(NOB_INFO, "serving on %s", path);
+
+    while (!serveStop) {
+        int conn = accept(fd, NULL, NULL);
+        if (conn<0) continue;
+        pid_t pid = fork();
+        if (pid==0) {
+            close(fd);
+            signal(SIGCHLD, SIG_DFL);
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            servePath = NULL;
+            serveFd = conn;
+            ServeConnection(ss);
+            exit(0);
         }
-    outloop:;
+        close(conn);
     }
-endloop:
-    free(strStore);
+    close(fd);
+    unlink(path);
+    servePath = NULL;
+    return 0;
 }
+#endif
 
-void ExitFunc(void)
+// embedding api, see ic.h
+
+#ifdef _WIN32
+CRITICAL_SECTION libLock;
+INIT_ONCE libLockOnce = INIT_ONCE_STATIC_INIT;
+
+BOOL CALLBACK LibLockInit(PINIT_ONCE once, PVOID param, PVOID *ctx)
+{
+    (void)once; (void)param; (void)ctx;
+    InitializeCriticalSection(&libLock);
+    return TRUE;
+}
+
+void LibLock(void)
+{
+    InitOnceExecuteOnce(&libLockOnce, LibLockInit, NULL, NULL);
+    EnterCriticalSection(&libLock);
+}
+
+void LibUnlock(void)
+{
+    LeaveCriticalSection(&libLock);
+}
+#else
+pthread_mutex_t libLock;
+pthread_once_t libLockOnce = PTHREAD_ONCE_INIT;
+
+void LibLockInit(void)
+{
+    // recursive: compiled code may call into another session
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&libLock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void LibLock(void)
+{
+    pthread_once(&libLockOnce, LibLockInit);
+    pthread_mutex_lock(&libLock);
+}
+
+void LibUnlock(void)
+{
+    pthread_mutex_unlock(&libLock);
+}
+#endif
+
+struct IcSession {
+    Session ss;
+};
+
+IcSession *ic_session_new(IcConfig const *config)
+{
+    IcConfig def = {0};
+    if (config==NULL) config = &def;
+    IcSession *is = calloc(1, sizeof(*is));
+    if (is==NULL) return NULL;
+    Session *ss = &is->ss;
+
+    LibLock();
+    size_t mark = nob_temp_save();
+    SessionSetTccDir(ss, config->tccDir!=NULL? config->tccDir: GetExePath());
+    if (config->workDir!=NULL) SessionSetWorkDir(ss, config->workDir);
+    if (config->cacheDir!=NULL) ss->cacheDir = HeapSprintf("%s", config->cacheDir);
+    if (config->compiler!=NULL) ss->compiler = HeapSprintf("%s", config->compiler);
+    for (int i = 0; i<config->optionCount; ++i) {
+        nob_da_append(&ss->opt, HeapSprintf("%s", config->options[i]));
+    }
+    ss->rt = config->runType==IC_RUN_CC? RT_CC:
+        config->runType==IC_RUN_DLL? RT_DLL: RT_MEM;
+    ss->werror = config->werror!=0;
+    nob_temp_rewind(mark);
+    LibUnlock();
+    return is;
+}
+
+// returns false if the session is already running code
+bool SessionEnter(Session *ss)
+{
+    LibLock();
+    if (ss->busy) {
+        nob_log(NOB_ERROR, "%s", "ic session called from its own code");
+        LibUnlock();
+        return false;
+    }
+    ss->busy = true;
+    return true;
+}
+
+void SessionLeave(Session *ss)
+{
+    ss->busy = false;
+    LibUnlock();
+}
+
+int ic_eval(IcSession *is, char const *code, int *result)
+{
+    Session *ss = &is->ss;
+    StrBuilder empty = {0};
+    if (!SessionEnter(ss)) return -1;
+
+    // not kept, the line counter is not advanced
+    usz line = ss->line;
+    ss->last.count = 0;
+    AppendCode(&ss->last, &line, code);
+    int r = Run(ss, ss->line, &empty, &ss->last);
+    bool ok = ss->ranMain;
+    SessionLeave(ss);
+
+    if (!ok) return -1;
+    if (result!=NULL) *result = r;
+    return 0;
+}
+
+int ic_define(IcSession *is, char const *code)
 {
-    mlHistorySave(mlHistoryDefault, hisPath);
+    Session *ss = &is->ss;
+    if (!SessionEnter(ss)) return -1;
+    bool ok = SessionDefine(ss, code);
+    SessionLeave(ss);
+    return ok? 0: -1;
 }
 
+void *ic_lookup_symbol(IcSession *is, char const *name)
+{
+    LibLock();
+    void *p = SessionSymbol(&is->ss, name);
+    LibUnlock();
+    return p;
+}
+
+void ic_session_free(IcSession *is)
+{
+    if (is==NULL) return;
+    Session *ss = &is->ss;
+    LibLock();
+    SessionUnload(ss);
+    if (ss->ownsWorkDir) RemoveTree(ss->workDir);
+
+    nob_sb_free(ss->out);
+    nob_sb_free(ss->pre);
+    nob_sb_free(ss->first);
+    nob_sb_free(ss->src);
+    nob_sb_free(ss->last);
+    nob_sb_free(ss->temp);
+    nob_sb_free(ss->tempCc);
+    nob_sb_free(ss->rawOutPath);
+    nob_sb_free(ss->outPath);
+    nob_sb_free(ss->compilerIdent);
+    nob_sb_free(ss->sbSrc);
+    nob_sb_free(ss->sbOpt);
+    nob_sb_free(ss->liveRawOutPath);
+    for (usz i = 0; i<ss->opt.count; ++i) free((char *)ss->opt.items[i]);
+    nob_da_free(ss->opt);
+    nob_da_free(ss->arg);
+    nob_da_free(ss->cells);
+    nob_sb_free(ss->heldErrors);
+    FixturesClear(ss);
+    nob_da_free(ss->fixtures);
+#ifdef _WIN32
+    nob_da_free(ss->loadedDlls);
+#endif
+    char const *strs[] = {
+        ss->tccDir, ss->incDir, ss->libDir, ss->workDir, ss->cacheDir,
+        ss->inpPath, ss->outRedirect, ss->errRedirect, ss->compiler,
+    };
+    for (usz i = 0; i<NOB_ARRAY_LEN(strs); ++i) free((char *)strs[i]);
+    LibUnlock();
+    free(is);
+}
+
+#ifndef IC_LIBRARY
 int main(int argc, char **argv)
 {
-    int ok, argStart = 0;
-    usz line = 0;
-    StrBuilder out = {0}, pre = {0}, first = {0}, 
-        src = {0}, last = {0}, temp = {0}, tempCc = {0};
-    Nob_Cmd opt = {0}, arg = {0};
-    RunType rt = RT_MEM;
-    bool werror = true;
+    int argStart = 0;
+    Session ss = { .rt = RT_MEM, .werror = true };
+    char const *scriptPath = NULL;
+    char const *sockPath = NULL;
+    bool isShebang = false;
+    bool resume = false;
+    StrBuilder evalText = {0};
 
     SetupPaths();
+    SessionSetTccDir(&ss, tccPath);
+    ss.useDataDir = true;
     atexit(ExitFunc);
 
-    mlSetCompletionMode(mlCompleteMode_Circular);
-    mlSetCompletionCallback(CompleteFunc, NULL);
-    mlSetAutoHint(1, 1, mlColor_Gray);
-    mlSetHighlightCallback(HighlightFunc, NULL);
-    mlHistoryLoad(mlHistoryDefault, hisPath);
-
     for (int i = 1; i<argc; ++i) {
         char *a = argv[i];
+        if (isShebang) {
+            // the script owns the rest of argv, "--" and "-h" included
+            nob_da_append(&ss.arg, a);
+            continue;
+        }
         if (strcmp(a, "-h")==0 || strcmp(a, "--help")==0) {
             printf(
-                "Usage: %s [dll | cc[=...]] [compiler options...] [-- program argv...]\n"
-                , argv[0]
+                "Usage: %s [--resume] [dll | cc[=...]] [compiler options...] [-- program argv...]\n"
+                "       %s run script [dll | cc[=...]] [compiler options...] [-- program argv...]\n"
+                "       %s [dll | cc[=...]] [compiler options...] script program argv... (#! scripts)\n"
+                "       %s -e code [-e code...] [dll | cc[=...]] [compiler options...]\n"
+                "       %s serve socket [dll | cc[=...]] [compiler options...] [-- program argv...]\n"
+                , argv[0], argv[0], argv[0], argv[0], argv[0]
             );
             return 0;
         }
+        if ((strcmp(a, "-e")==0 || strcmp(a, "--eval")==0) && i+1<argc) {
+            // each -e is one line of input
+            nob_sb_append_cstr(&evalText, argv[++i]);
+            nob_da_append(&evalText, '\n');
+            continue;
+        }
+        if (i==1 && strcmp(a, "run")==0 && i+1<argc) {
+            scriptPath = argv[++i];
+            continue;
+        }
+        if (!argStart && strcmp(a, "--resume")==0) {
+            resume = true;
+            continue;
+        }
+        if (i==1 && strcmp(a, "serve")==0 && i+1<argc) {
+            sockPath = argv[++i];
+            continue;
+        }
+        if (scriptPath==NULL && !argStart && a[0]!='-' && IsShebangFile(a)) {
+            // #!/usr/bin/env ic: everything after the script goes to the program
+            scriptPath = a;
+            programName = a;
+            isShebang = true;
+            argStart = 1;
+            continue;
+        }
         if (strcmp(a, "dll")==0) {
-            rt = RT_DLL;
+            ss.rt = RT_DLL;
             continue;
         }
         if (strcmp(a, "cc")==0) {
-            rt = RT_CC;
+            ss.rt = RT_CC;
             continue;
         }
         if (strncmp(a, "cc=", 3)==0) {
-            myCompiler = a+3;
-            rt = RT_CC;
+            ss.compiler = a+3;
+            ss.rt = RT_CC;
             continue;
         }
         if (strcmp(a, "--")==0) argStart = 1;
-        else if (argStart) nob_da_append(&arg, a);
-        else nob_da_append(&opt, a);
+        else if (argStart) nob_da_append(&ss.arg, a);
+        else nob_da_append(&ss.opt, a);
     }
 
-    puts("Type \""CMD_SIGN"h\" for help");
-    for (;;) {
-        usz outLine = line;
-        enum InputKind kind = GetInput(&out, &outLine, false, false);
-        enum InputKind kind2;
-        bool once = false;
-        if (kind==Empty) {
-            continue;
-        } else if (kind==InputEnd) {
-            break;
-        } else if (kind==Shell) {
-            SpawnShell(out.items+1, out.count-1);
-        } else if (kind==Cmd) {
-            switch (out.items[1]) {
-            default:
-                if (isspace(out.items[1])) {
-                    Help();
-                    continue;
-                }
-                printf("Unknown command \"%.*s\"\n", (int)out.count-1, out.items);
-            break; case 'h':
-                Help();
-            break; case 'q':
-                goto endloop;
-            break; case 'l':
-                printf("/* top */\n");
-                printf("%.*s", (int)pre.count, pre.items);
-                printf("/* main */\n");
-                printf("%.*s", (int)src.count, src.items);
-            break; case 'c':
-                pre.count = 0;
-                src.count = 0;
-                line = 0;
-            break; case 'A':
-                arg.count = 0;
-                puts("cleared arguments");
-            break; case 'a':
-                if (out.count-1>2) {
-                    ParseShell(out.items+2, out.count-2, &arg);
-                }
-                printf("current arguments:");
-                for (usz i = 0; i<arg.count; ++i) {
-                    printf(" '%s'", arg.items[i]);
-                }
-                puts("");
-            break; case 'O':
-                opt.count = 0;
-                puts("cleared options");
-            break; case 'o':
-                if (out.count-1>2) {
-                    ParseShell(out.items+2, out.count-2, &opt);
-                }
-                printf("current options:");
-                for (usz i = 0; i<opt.count; ++i) {
-                    printf(" '%s'", opt.items[i]);
-                }
-                puts("");
-            break; case 'p':
-                if (out.count-1>2) {
-                    first.count = 0;
-                    last.count = 0;
-                    AppendLineNum(&last, 1+line);
-                    nob_sb_append_cstr(&last, "__printmem(&(");
-                    nob_sb_append_buf(&last, out.items+2, out.count-3);
-                    nob_sb_append_cstr(&last, "),sizeof(");
-                    nob_sb_append_buf(&last, out.items+2, out.count-3);
-                    nob_sb_append_cstr(&last, "));\n");
-                    goto run_label;
-                }
-            break; case 'P':
-                if (out.count-1>2) {
-                    first.count = 0;
-                    last.count = 0;
-                    AppendLineNum(&last, 1+line);
-                    nob_sb_append_cstr(&last, "__printmem(");
-                    nob_sb_append_buf(&last, out.items+2, out.count-3);
-                    nob_sb_append_cstr(&last, ");\n");
-                    goto run_label;
-                }
-            break; case 't':
-                if (out.count-1>2 && out.items[2]==':') {
-                    // time multiple
-                    temp.count = 0;
-                    nob_sb_append_buf(&temp, out.items+3, out.count-4);
-                } else {
-                    // time once
-                    once = true;
-                }
-                outLine = line;
-                kind2 = GetInput(&out, &outLine, false, true);
-                if (kind2==Expr) {
-                    nob_sb_append_cstr(&out, ";");
-                } else if (kind2!=Stmt) {
-                    printf("Expected statement or expression after \""CMD_SIGN"t\"\n");
-                    continue;
-                }
-                AppendTiming(&first, &last, line, once, &temp, &out);
-                goto run_label;
-            break; case 'f':
-                outLine = line;
-                kind2 = GetInput(&out, &outLine, true, false);
-                if (kind2==Stmt || kind2==Expr) { // functions are recognized as expressions for now...
-                    kind = Pre;
-                    goto prep_label;
-                } else {
-                    printf("Expected statement after \""CMD_SIGN"f\"\n");
-                    continue;
-                }
-            break; case 'm':
-                if (out.count-1>2) {
-                    first.count = 0;
-                    last.count = 0;
-                    AppendLineNum(&last, 1+line);
-                    nob_sb_append_cstr(&last, "printf(\"%s\\n\", __IC_STRINGIFY(");
-                    nob_sb_append_buf(&last, out.items+2, out.count-3);
-                    nob_sb_append_cstr(&last, "));\n");
-                    goto run_label;
-                }
-            break; case ';':
-                // reload last
-                goto run_label;
-            break; case 'r':
-                switch (out.items[2]) {
-                default:
-                break; case 'c': rt = RT_CC;
-                    compilerType = COMPILER_UNDECIDED; // reset compiler type
-                    if (out.items[3]=='=') {
-                        if (out.items[4]=='\n') {
-                            myCompiler = NULL;
-                        } else {
-                            Nob_String_View sv = nob_sv_trim(
-                                nob_sv_from_parts(out.items+4, out.count-4));
-                            tempCc.count = 0;
-                            nob_sb_append_buf(&tempCc, sv.data, sv.count);
-                            nob_sb_append_null(&tempCc);
-                            myCompiler = tempCc.items;
-                        }
-                    }
-                break; case 'd': rt = RT_DLL;
-                break; case 'm': rt = RT_MEM;
-                }
-                printf("run type: %s, ",
-                    rt==RT_CC? "cc":
-                    rt==RT_DLL? "dll":
-                    "mem");
-                printf("compiler: %s\n",
-                    rt==RT_CC? GetCompiler():
-                    "tcc");
-            break; case 'w':
-                werror = true;
-                printf("warnings as errors: on\n");
-            break; case 'W':
-                werror = false;
-                printf("warnings as errors: off\n");
-            }
-        } else {
-        prep_label:
-            last.count = 0;
-            if (kind==Stmt) {
-                AppendLineNum(&last, 1+line);
-                nob_sb_append_buf(&last, out.items, out.count);
-            } else if (kind==Expr) {
-                AppendLineNum(&last, 1+line);
-                nob_sb_append_cstr(&last, "PRINT((");
-                nob_sb_append_buf(&last, out.items, out.count-1);
-                nob_sb_append_cstr(&last, "));\n");
-            }
+    if (evalText.count>0) {
+        // skip everything interactive, the data dir is set up by Run if needed
+        scriptText = nob_sv_from_parts(evalText.items, evalText.count);
+        useScriptText = true;
+        ss.batch = true;
+        while (Step(&ss)) {}
+        Flush(&ss);
+        fflush(stdout);
+        return ss.failed? 1: ss.status;
+    }
 
-            first.count = 0;
-            if (kind==Pre) {
-                AppendLineNum(&first, 1+line);
-                nob_sb_append_buf(&first, out.items, out.count);
-            }
-        run_label:
-            ok = Run(rt, line,
-                &opt, &arg,
-                &pre, &first,
-                &src, &last,
-                werror
-            ) >= 0;
-            if (ok) {
-                if (kind==Stmt) {
-                    line = outLine;
-                    nob_sb_append_buf(&src, last.items, last.count);
-                } else if (kind==Pre) {
-                    line = outLine;
-                    nob_sb_append_buf(&pre, first.items, first.count);
-                }
-            }
+    SetupDataPaths();
+    if (sockPath!=NULL) {
+#ifdef _WIN32
+        nob_log(NOB_ERROR, "%s", "serve is not supported on windows");
+        return 1;
+#else
+        return Serve(&ss, sockPath);
+#endif
+    }
+    if (scriptPath!=NULL) {
+        scriptFile = fopen(scriptPath, "rb");
+        if (scriptFile==NULL) {
+            nob_log(NOB_ERROR, "could not open %s: %s", scriptPath, strerror(errno));
+            return 1;
+        }
+        if (IsShebangFile(scriptPath)) {
+            // skip the #! line but keep the line numbers
+            int c;
+            while ((c = fgetc(scriptFile))!=EOF && c!='\n') {}
+            ss.line = 1;
         }
+        // quoted includes next to the script
+        nob_da_append(&ss.opt, nob_temp_sprintf("-I%s", nob_temp_dir_name(scriptPath)));
+        // a cached shared object lets later runs skip the compiler entirely
+        if (isShebang && ss.rt==RT_MEM) ss.rt = RT_DLL;
+    } else if (!mlIsATTY()) {
+        scriptFile = stdin;
     }
-endloop:
+
+    if (scriptFile!=NULL) {
+        ss.batch = true;
+        while (Step(&ss)) {}
+        Flush(&ss);
+        fflush(stdout);
+        return ss.failed? 1: ss.status;
+    }
+
+    mlSetCompletionMode(mlCompleteMode_Circular);
+    mlSetCompletionCallback(CompleteFunc, NULL);
+    mlSetAutoHint(1, 1, mlColor_Gray);
+    mlSetHighlightCallback(HighlightFunc, NULL);
+    mlHistoryLoad(mlHistoryDefault, hisPath);
+    historyLoaded = true;
+
+    // recover a session that crashed, then keep a journal of this one
+    if (resume) ResumeJournal(&ss);
+    OpenJournal(&ss);
+
+    puts("Type \""CMD_SIGN"h\" for help");
+    while (Step(&ss)) {}
     return 0;
 }
+#endif // IC_LIBRARY
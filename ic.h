@@ -0,0 +1,64 @@
+#ifndef IC_H_
+#define IC_H_
+
+// Embedding ic: build libic.a with `./nob lib` and link it together with
+// libtcc (-ltcc -lm, plus -ldl -lpthread on posix).
+//
+// A session works like the repl: every evaluation recompiles everything
+// defined so far. The unit compiled by the last successful call stays
+// loaded, so pointers from ic_lookup_symbol are plain native pointers,
+// valid until the next successful ic_eval/ic_define or ic_session_free.
+//
+// Sessions keep separate state but don't run concurrently: every call
+// holds one process-wide lock until it returns, evaluated code included,
+// so ic_eval on two threads runs one after the other. Compiled code may
+// call into other sessions but not into its own.
+// libic.a carries the implementation of nob.h, don't define
+// NOB_IMPLEMENTATION in the host. Everything else in it is local, the host
+// only sees ic_* and nob_* (not with msvc, where ic.lib exports it all).
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct IcSession IcSession;
+
+typedef enum IcRunType {
+    IC_RUN_MEM, // tcc in memory
+    IC_RUN_DLL, // tcc to a shared library
+    IC_RUN_CC,  // external compiler to a shared library
+} IcRunType;
+
+typedef struct IcConfig {
+    char const *tccDir;   // libtcc1.a, include/, lib/ and nob.h; NULL: next to the executable
+    char const *workDir;  // scratch files of dll/cc; NULL: a private temp dir removed on free
+    char const *cacheDir; // compiled shared libraries shared between sessions; NULL: no cache
+    char const *compiler; // cc mode; NULL: $CC or the default of nob.h
+    char const *const *options; // compiler options, e.g. "-O2", "-lm"
+    int optionCount;
+    IcRunType runType;
+    int werror;
+} IcConfig;
+
+// NULL config: in memory tcc next to the executable
+IcSession *ic_session_new(IcConfig const *config);
+
+// compile and run statements once, `return x;` sets *result (0 otherwise)
+// returns 0 on success, -1 if the code does not compile or load
+int ic_eval(IcSession *session, char const *code, int *result);
+
+// add top level code (includes, types, globals, functions) to the session
+// returns 0 on success, -1 if it does not compile (and the session is unchanged)
+int ic_define(IcSession *session, char const *code);
+
+// global of the currently loaded unit, NULL if not found;
+// on windows dll/cc units only export __declspec(dllexport) symbols
+void *ic_lookup_symbol(IcSession *session, char const *name);
+
+void ic_session_free(IcSession *session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IC_H_
@@ -29,6 +29,53 @@ void download_file(char const *url, char const *out_path)
     da_free(cmd);
 }
 
+int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// median wall time of `ic -e` must stay under the budget (ms)
+bool bench_startup(void)
+{
+    enum { WARMUP = 3, RUNS = 31 };
+#ifdef _WIN32
+    const char *null_path = "NUL";
+#else
+    const char *null_path = "/dev/null";
+#endif
+    const char *budget_env = getenv("IC_STARTUP_BUDGET_MS");
+    double budget_ms = budget_env ? atof(budget_env) : 10.0;
+    uint64_t samples[RUNS];
+    Cmd cmd = {0};
+    bool result = true;
+
+    Log_Level old_level = minimal_log_level;
+    minimal_log_level = WARNING;
+    for (int i = 0; i < WARMUP + RUNS; ++i) {
+        cmd_append(&cmd, "./ic", "-e", "1+1");
+        uint64_t start = nanos_since_unspecified_epoch();
+        if (!cmd_run(&cmd, .stdout_path = null_path)) return_defer(false);
+        uint64_t end = nanos_since_unspecified_epoch();
+        if (i >= WARMUP) samples[i - WARMUP] = end - start;
+    }
+    minimal_log_level = old_level;
+
+    qsort(samples, RUNS, sizeof(*samples), compare_u64);
+    double median_ms = samples[RUNS/2] / 1e6;
+    nob_log(INFO, "ic -e startup: min %.2fms, median %.2fms, max %.2fms (budget %.2fms)",
+        samples[0] / 1e6, median_ms, samples[RUNS - 1] / 1e6, budget_ms);
+    if (median_ms > budget_ms) {
+        nob_log(ERROR, "ic -e startup is over budget");
+        return_defer(false);
+    }
+
+defer:
+    minimal_log_level = old_level;
+    da_free(cmd);
+    return result;
+}
+
 int main(int argc, char **argv)
 {
     if (argc == 2 && strcmp(argv[1], "update-nob") == 0) {
@@ -42,6 +89,10 @@ int main(int argc, char **argv)
 
     bool run = false;
     if (argc == 2 && strcmp(argv[1], "run") == 0) run = true;
+    bool bench = false;
+    if (argc == 2 && strcmp(argv[1], "bench") == 0) bench = true;
+    bool lib = false;
+    if (argc == 2 && strcmp(argv[1], "lib") == 0) lib = true;
 
     Cmd cmd = {0};
 
@@ -99,6 +150,39 @@ int main(int argc, char **argv)
 
     // if (!mkdir_if_not_exists("./temp")) return 1;
 
+    if (lib) {
+        // embeddable evaluator, see ic.h
+        nob_cc(&cmd);
+        nob_cc_flags(&cmd);
+        cmd_append(&cmd, "-DIC_LIBRARY", "-c");
+#ifdef _MSC_VER
+        cmd_append(&cmd, "/Fo:ic_lib.obj");
+#else
+        cmd_append(&cmd, "-o", "ic_lib.o");
+#endif
+        nob_cc_inputs(&cmd, "./ic.c");
+        if (!cmd_run(&cmd, .dont_reset=0)) return 1;
+#ifdef _MSC_VER
+        cmd_append(&cmd, "lib.exe", "/nologo", "/OUT:ic.lib", "ic_lib.obj");
+#else
+        // keep only the api and nob.h global, ic's own Run, Help, Cd...
+        // would clash with the host's symbols
+#ifdef __APPLE__
+        cmd_append(&cmd, "ld", "-r", "-exported_symbol", "_ic_*", "-exported_symbol", "_nob_*", "-o", "ic_lib_local.o", "ic_lib.o");
+#else
+        cmd_append(&cmd, "objcopy", "-w", "--keep-global-symbol=ic_*", "--keep-global-symbol=nob_*", "ic_lib.o", "ic_lib_local.o");
+#endif
+        if (!cmd_run(&cmd, .dont_reset=0)) return 1;
+        // an older libic.a may still hold ic_lib.o
+        if (file_exists("libic.a") == 1 && !delete_file("libic.a")) return 1;
+        cmd_append(&cmd, "ar", "rcs", "libic.a", "ic_lib_local.o");
+#endif
+        if (!cmd_run(&cmd, .dont_reset=0)) return 1;
+        return 0;
+    }
+
+    if (bench) return bench_startup() ? 0 : 1;
+
     if (!run) return 0;
 
     cmd_append(&cmd, "./ic");